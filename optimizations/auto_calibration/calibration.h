@@ -0,0 +1,208 @@
+#pragma once
+// Parallelism thresholds of the hash join and their startup calibration.
+// The defaults are the constants tuned on the development machine. With SPC_CALIBRATE
+// set, build_context() times synthetic joins on a ladder of sizes (single vs multi
+// threaded build, serial vs parallel probe) and keeps the first size where the parallel
+// variant wins, comparing the median of several runs per size. When the parallel variant
+// never wins on the ladder, the threshold goes past its top (or stays at the default if
+// that is larger). Results are cached in SPC_CALIBRATION_FILE and reused on the same host
+// key: thread count, usable CPUs (affinity mask and cgroup CPU quota) and CPU model.
+// SPC_FORCE_THREADS and SPC_THREADED_MIN_BUILD still override whatever was derived.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+#include <hardware.h>
+
+namespace calibration{
+
+    constexpr size_t NEVER = std::numeric_limits<size_t>::max();
+    constexpr int FILE_VERSION = 2;
+    constexpr size_t RUNS = 5; // timings per ladder point, the median is compared
+
+    struct Thresholds{
+        size_t threads = SPC__THREAD_COUNT > 0 ? static_cast<size_t>(SPC__THREAD_COUNT) : 4;
+        size_t single_thread_build = 200000; // smaller builds use one thread on the threaded path
+        size_t threaded_min_build = 600000;  // from here on the partitioned threaded build is used
+        size_t parallel_probe_rows = 0;      // smaller probe sides are probed by one thread
+    };
+
+    inline size_t env_size(const char* name){
+        const char* v = std::getenv(name);
+        if(!v || !*v) return 0;
+        char* end = nullptr;
+        const unsigned long parsed = std::strtoul(v, &end, 10);
+        return end == v ? 0 : static_cast<size_t>(parsed);
+    }
+
+    inline Thresholds with_env_overrides(Thresholds thresholds){
+        if(const size_t forced = env_size("SPC_FORCE_THREADS")) thresholds.threads = forced;
+        if(const size_t min_build = env_size("SPC_THREADED_MIN_BUILD")) thresholds.threaded_min_build = min_build;
+        return thresholds;
+    }
+
+    // CPUs this process may run on: affinity mask, capped by the cgroup CPU quota
+    inline size_t available_cpus(){
+        size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        if(sched_getaffinity(0, sizeof(set), &set) == 0) cpus = std::max(1, CPU_COUNT(&set));
+
+        auto apply_quota = [&](long long quota, long long period) {
+            if(quota > 0 && period > 0) cpus = std::min(cpus, static_cast<size_t>(std::max(1LL, (quota + period - 1) / period)));
+        };
+        // cgroup v2: "<quota> <period>" or "max <period>"
+        if(FILE* f = fopen("/sys/fs/cgroup/cpu.max", "r")){
+            char quota[32] = {};
+            long long period = 0;
+            if(fscanf(f, "%31s %lld", quota, &period) == 2 && strcmp(quota, "max") != 0) apply_quota(atoll(quota), period);
+            fclose(f);
+        }
+        // cgroup v1
+        else if(FILE* q = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r")){
+            long long quota = -1, period = 0;
+            if(fscanf(q, "%lld", &quota) != 1) quota = -1;
+            fclose(q);
+            if(FILE* p = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r")){
+                if(fscanf(p, "%lld", &period) != 1) period = 0;
+                fclose(p);
+            }
+            apply_quota(quota, period);
+        }
+        return cpus;
+    }
+
+    // "model name" of the first CPU in /proc/cpuinfo, blanks replaced so it is one token
+    inline std::string cpu_model(){
+        std::string model = "unknown";
+        if(FILE* f = fopen("/proc/cpuinfo", "r")){
+            char line[256];
+            while(fgets(line, sizeof(line), f)){
+                if(strncmp(line, "model name", 10) != 0) continue;
+                const char* value = strchr(line, ':');
+                if(!value) break;
+                model.clear();
+                for(++value; *value; ++value){
+                    if(*value == '\n') break;
+                    if(*value == ' ' || *value == '\t'){
+                        if(!model.empty() && model.back() != '_') model += '_';
+                    }
+                    else model += *value;
+                }
+                if(!model.empty() && model.back() == '_') model.pop_back();
+                if(model.empty()) model = "unknown";
+                break;
+            }
+            fclose(f);
+        }
+        return model;
+    }
+
+    // What the cached thresholds were measured on
+    inline std::string host_key(size_t threads){
+        return "threads=" + std::to_string(threads) + ",cpus=" + std::to_string(available_cpus()) + ",cpu=" + cpu_model();
+    }
+
+    // Cached thresholds, only when they were measured under the same host key
+    inline bool load(const std::string& path, const std::string& key, Thresholds& thresholds){
+        FILE* f = fopen(path.c_str(), "r");
+        if(!f) return false;
+        int version = 0;
+        char stored_key[512] = {};
+        Thresholds loaded;
+        const bool ok = fscanf(f, "spc-calibration %d host %511s threads %zu single_thread_build %zu threaded_min_build %zu parallel_probe_rows %zu",
+                            &version, stored_key, &loaded.threads, &loaded.single_thread_build, &loaded.threaded_min_build, &loaded.parallel_probe_rows) == 6;
+        fclose(f);
+        if(!ok || version != FILE_VERSION || key != stored_key) return false;
+        thresholds = loaded;
+        return true;
+    }
+
+    inline void save(const std::string& path, const std::string& key, const Thresholds& thresholds){
+        FILE* f = fopen(path.c_str(), "w");
+        if(!f){
+            fprintf(stderr, "calibration: cannot write %s\n", path.c_str());
+            return;
+        }
+        fprintf(f, "spc-calibration %d\nhost %s\nthreads %zu\nsingle_thread_build %zu\nthreaded_min_build %zu\nparallel_probe_rows %zu\n",
+            FILE_VERSION, key.c_str(), thresholds.threads, thresholds.single_thread_build, thresholds.threaded_min_build, thresholds.parallel_probe_rows);
+        fclose(f);
+    }
+
+    inline std::string describe(const Thresholds& thresholds){
+        auto rows = [](size_t value) { return value == NEVER ? std::string("never") : std::to_string(value); };
+        return std::to_string(thresholds.threads) + " threads, multi-threaded build from " + rows(thresholds.single_thread_build) +
+            " rows, threaded build from " + rows(thresholds.threaded_min_build) + " rows, parallel probe from " +
+            rows(thresholds.parallel_probe_rows) + " rows";
+    }
+
+    // Median of RUNS timings of one ladder point, so that one preempted run does not move a threshold
+    template <typename TimeJoin>
+    double median_time(TimeJoin& time_join, const Thresholds& forced, size_t build_rows, size_t probe_rows){
+        std::vector<double> times(RUNS);
+        for(double& time : times) time = time_join(forced, build_rows, probe_rows);
+        std::nth_element(times.begin(), times.begin() + RUNS / 2, times.end());
+        return times[RUNS / 2];
+    }
+
+    // Derives the thresholds for threads workers. time_join(forced, build_rows, probe_rows) runs
+    // a synthetic join under the forced thresholds once and returns its wall time.
+    template <typename TimeJoin>
+    Thresholds calibrate(size_t threads, TimeJoin&& time_join){
+        Thresholds defaults;
+        defaults.threads = threads;
+        if(threads <= 1) return defaults; // nothing to run in parallel, nothing to measure
+
+        Thresholds result = defaults;
+        result.single_thread_build = NEVER;
+        result.threaded_min_build = NEVER;
+        result.parallel_probe_rows = NEVER;
+
+        // build: threaded with one thread, threaded with all threads, unthreaded
+        Thresholds threaded_one;
+        threaded_one.threads = 1;
+        threaded_one.single_thread_build = 0;
+        threaded_one.threaded_min_build = 0;
+        Thresholds threaded_all = threaded_one;
+        threaded_all.threads = threads;
+        Thresholds unthreaded = threaded_all;
+        unthreaded.threaded_min_build = NEVER;
+
+        constexpr size_t BUILD_LADDER_TOP = size_t{1} << 20;
+        for(size_t rows : {size_t{1} << 14, size_t{1} << 16, size_t{1} << 18, BUILD_LADDER_TOP}){
+            const double one = median_time(time_join, threaded_one, rows, rows);
+            const double all = median_time(time_join, threaded_all, rows, rows);
+            const double plain = median_time(time_join, unthreaded, rows, rows);
+            if(result.single_thread_build == NEVER && all < one) result.single_thread_build = rows;
+            const double threaded = rows >= result.single_thread_build ? all : one;
+            if(result.threaded_min_build == NEVER && threaded < plain) result.threaded_min_build = rows;
+        }
+        // no crossover on the ladder: the parallel variant lost up to its top
+        if(result.single_thread_build == NEVER) result.single_thread_build = std::max(defaults.single_thread_build, BUILD_LADDER_TOP);
+        if(result.threaded_min_build == NEVER) result.threaded_min_build = std::max(defaults.threaded_min_build, BUILD_LADDER_TOP);
+
+        // probe: a small unthreaded build probed by one thread or by all of them
+        Thresholds probe_one = unthreaded;
+        probe_one.threads = 1;
+        Thresholds probe_all = unthreaded;
+        constexpr size_t PROBE_LADDER_TOP = size_t{1} << 18;
+        for(size_t rows : {size_t{1} << 12, size_t{1} << 14, size_t{1} << 16, PROBE_LADDER_TOP}){
+            if(median_time(time_join, probe_all, size_t{1} << 14, rows) < median_time(time_join, probe_one, size_t{1} << 14, rows)){
+                result.parallel_probe_rows = rows;
+                break;
+            }
+        }
+        if(result.parallel_probe_rows == NEVER) result.parallel_probe_rows = std::max(defaults.parallel_probe_rows, PROBE_LADDER_TOP);
+        return result;
+    }
+
+} // namespace calibration
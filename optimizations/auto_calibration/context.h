@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <page_pool.h>
+#include <table_file.h>
+#include <index_file.h>
+#include <profile.h>
+#include <calibration.h>
+
+namespace Contest {
+
+    // State kept across queries: created by build_context(), passed to every execute()
+    struct ExecuteContext{
+        pagepool::PagePool page_pool;
+        std::vector<std::unique_ptr<indexfile::MappedIndex>> indexes; // prebuilt indexes from SPC_INDEX_DIR
+        indexfile::IdentityCache identities;                          // fingerprints of the input columns matched against them
+        std::map<std::string, std::unique_ptr<tablefile::MappedTable>> tables; // input tables from SPC_TABLE_DIR, by file stem
+        calibration::Thresholds thresholds;                            // when to build and probe in parallel
+
+        // EXPLAIN ANALYZE: profile of the last query, dumped as JSON to profile_target (SPC_PROFILE)
+        bool profiling = false;
+        std::string profile_target;
+        size_t queries = 0;
+        profile::QueryProfile profile;
+
+        explicit ExecuteContext(size_t page_pool_bytes) : page_pool(page_pool_bytes) {}
+    };
+
+} // namespace Contest
@@ -0,0 +1,233 @@
+#pragma once
+// Hopscotch join engine with hop bitmaps: a key lives within H slots of its home slot, and
+// the home keeps an H bit bitmap of the slots that hold its keys. A lookup reads the bitmap
+// first (a miss usually ends there) and compares keys only in the 4 slot chunks that have
+// bits set, one AVX2 compare per chunk. find_ranges resolves a batch of keys with the
+// bitmaps and neighborhoods of the whole batch prefetched first.
+// H is a template parameter and sets the load factor the inserts sustain with random keys:
+// 0.5 for 16 slots (a neighborhood within two cache lines), 0.75 for 32 and 0.85 for 64.
+// Slots are 8 byte entries in cache line aligned storage, H slots of padding after the
+// last home slot so neighborhoods never wrap. A key with a single build row keeps it in its
+// slot, keys with duplicates point their slot into the side chain: a header entry holding
+// their count, followed by their entries. Empty slots hold INT32_MIN, the NULL key.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <unchained_table.h>
+#include <grouped_table.h>
+
+namespace jointable{
+
+    template <size_t H>
+    struct BitmapHopscotchTable{
+        static_assert(H == 16 || H == 32 || H == 64, "neighborhoods of 16, 32 or 64 slots");
+
+        using Hop = std::conditional_t<H == 16, uint16_t, std::conditional_t<H == 32, uint32_t, uint64_t>>;
+        static constexpr int32_t EMPTY_KEY = INT32_MIN;
+        static constexpr uint32_t DUPLICATES = 1u << 31; // slot row_idx: header position in chain (build rows stay below 2^31)
+        static constexpr double MAX_LOAD = H == 16 ? 0.5 : H == 32 ? 0.75 : 0.85;
+        static constexpr size_t BATCH = 16;
+
+        struct alignas(64) Line{
+            HashEntry slots[8];
+        };
+
+        std::vector<Line> lines;      // capacity + H slots
+        std::vector<Hop> hops;        // per home slot
+        std::vector<HashEntry> chain; // keys with duplicates: header {key, count}, then their entries
+        size_t capacity = 0;
+        size_t num_elements = 0;
+
+        HashEntry* slots(){ return lines.front().slots; }
+        const HashEntry* slots() const{ return lines.front().slots; }
+
+        void reserve(size_t build_size){
+            allocate(std::max<size_t>(H, static_cast<size_t>(static_cast<double>(build_size) / MAX_LOAD) + 1));
+        }
+
+        // Multiply-shift maps the hash to any capacity, so the table can be sized to the load factor
+        size_t home(int32_t key) const{
+            return static_cast<size_t>((static_cast<uint64_t>(mix32(key)) * capacity) >> 32);
+        }
+
+        // Bit i set: slot pos + i holds key, for the 4 slots from pos
+        static uint32_t match4(const HashEntry* at, int32_t key){
+#if defined(__AVX2__)
+            const __m256i needle = _mm256_set1_epi64x(static_cast<int64_t>(static_cast<uint32_t>(key)));
+            const __m256i keys = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(at)), _mm256_set1_epi64x(0xFFFFFFFFll));
+            return static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, needle))));
+#else
+            uint32_t bits = 0;
+            for(size_t i = 0; i < 4; ++i) bits |= static_cast<uint32_t>(at[i].key == key) << i;
+            return bits;
+#endif
+        }
+
+        const HashEntry* find_entry(int32_t key) const{
+            return find_in(home(key), key);
+        }
+
+        const HashEntry* find_in(size_t h, int32_t key) const{
+            uint64_t bits = hops[h];
+            const HashEntry* neighborhood = slots() + h;
+            while(bits){
+                const size_t chunk = static_cast<size_t>(__builtin_ctzll(bits)) & ~size_t{3};
+                const uint32_t found = match4(neighborhood + chunk, key) & static_cast<uint32_t>((bits >> chunk) & 0xF);
+                if(found) return neighborhood + chunk + __builtin_ctz(found);
+                bits &= ~(uint64_t{0xF} << chunk);
+            }
+            return nullptr;
+        }
+
+        // Pass 1 places the first row of every key and counts the others in its slot.
+        // Pass 2 (only when there are duplicates) fills the side chain.
+        template <typename EntryAt>
+        void build_parallel(size_t count, [[maybe_unused]] size_t threads, EntryAt&& entry_at){
+            HashEntry entry;
+            num_elements = 0;
+            bool duplicates = false;
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                ++num_elements;
+                if(auto* slot = const_cast<HashEntry*>(find_entry(entry.key))){
+                    slot->row_idx = (slot->row_idx & DUPLICATES) ? slot->row_idx + 1 : DUPLICATES | 2;
+                    duplicates = true;
+                    continue;
+                }
+                while(!insert(entry)) grow();
+            }
+            if(!duplicates) return;
+
+            // headers count up again while the entries are copied
+            chain.clear();
+            HashEntry* all = slots();
+            for(size_t pos = 0; pos < capacity + H; ++pos){
+                HashEntry& slot = all[pos];
+                if(slot.key == EMPTY_KEY || !(slot.row_idx & DUPLICATES)) continue;
+                const uint32_t header = static_cast<uint32_t>(chain.size());
+                chain.resize(chain.size() + 1 + (slot.row_idx & ~DUPLICATES));
+                chain[header] = HashEntry(slot.key, 0);
+                slot.row_idx = DUPLICATES | header;
+            }
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                const HashEntry* slot = find_entry(entry.key);
+                if(!(slot->row_idx & DUPLICATES)) continue;
+                HashEntry& header = chain[slot->row_idx & ~DUPLICATES];
+                (&header)[1 + header.row_idx++] = entry;
+            }
+        }
+
+        const HashEntry* find_range(int32_t key, size_t& len) const{
+            return range_of(key == EMPTY_KEY ? nullptr : find_entry(key), len);
+        }
+
+        // Batched probe: ranges[i], lens[i] as find_range(keys[i], lens[i]) would return them
+        void find_ranges(const int32_t* keys, size_t count, const HashEntry** ranges, size_t* lens) const{
+            size_t homes[BATCH];
+            for(size_t begin = 0; begin < count; begin += BATCH){
+                const size_t n = std::min(BATCH, count - begin);
+                for(size_t i = 0; i < n; ++i){
+                    homes[i] = home(keys[begin + i]);
+                    __builtin_prefetch(&hops[homes[i]]);
+                    __builtin_prefetch(slots() + homes[i]);
+                }
+                for(size_t i = 0; i < n; ++i){
+                    const int32_t key = keys[begin + i];
+                    ranges[begin + i] = range_of(key == EMPTY_KEY ? nullptr : find_in(homes[i], key), lens[begin + i]);
+                }
+            }
+        }
+
+        size_t size() const{
+            return num_elements;
+        }
+
+        size_t bytes() const{
+            return lines.size() * sizeof(Line) + hops.size() * sizeof(Hop) + chain.capacity() * sizeof(HashEntry);
+        }
+
+    private:
+        const HashEntry* range_of(const HashEntry* slot, size_t& len) const{
+            if(!slot){
+                len = 0;
+                return nullptr;
+            }
+            if(!(slot->row_idx & DUPLICATES)){
+                len = 1;
+                return slot;
+            }
+            const HashEntry* header = chain.data() + (slot->row_idx & ~DUPLICATES);
+            len = header->row_idx;
+            return header + 1;
+        }
+
+        void allocate(size_t slots_wanted){
+            capacity = slots_wanted;
+            lines.assign((capacity + H + 7) / 8, Line{});
+            for(auto& line : lines){
+                for(auto& slot : line.slots) slot = HashEntry(EMPTY_KEY, 0);
+            }
+            hops.assign(capacity, 0);
+        }
+
+        // Places entry (a key not in the table yet); false when its neighborhood has no room
+        bool insert(const HashEntry& entry){
+            HashEntry* all = slots();
+            const size_t end = capacity + H;
+            const size_t i = home(entry.key);
+            size_t j = i;
+            while(j < end && all[j].key != EMPTY_KEY) ++j;
+            if(j == end) return false;
+
+            // hop the free slot back: move a key whose home also reaches j into it
+            // (a free slot in the padding has fewer than H homes before it)
+            while(j - i >= H){
+                bool moved = false;
+                for(size_t h = j - H + 1; h < std::min(j, capacity) && !moved; ++h){
+                    for(Hop bits = hops[h]; bits; bits &= bits - 1){
+                        const size_t k = h + static_cast<size_t>(__builtin_ctzll(bits));
+                        if(k >= j) break;
+                        all[j] = all[k];
+                        all[k] = HashEntry(EMPTY_KEY, 0);
+                        hops[h] = static_cast<Hop>((hops[h] & ~(Hop{1} << (k - h))) | (Hop{1} << (j - h)));
+                        j = k;
+                        moved = true;
+                        break;
+                    }
+                }
+                if(!moved) return false;
+            }
+
+            all[j] = entry;
+            hops[i] |= Hop{1} << (j - i);
+            return true;
+        }
+
+        // Grows the capacity by a quarter and reinserts every key with its row or count
+        void grow(){
+            std::vector<HashEntry> old;
+            old.reserve(num_elements);
+            for(size_t pos = 0; pos < capacity + H; ++pos){
+                if(slots()[pos].key != EMPTY_KEY) old.push_back(slots()[pos]);
+            }
+            size_t slots_wanted = capacity;
+            bool placed = false;
+            while(!placed){
+                slots_wanted += slots_wanted / 4;
+                allocate(slots_wanted);
+                placed = std::all_of(old.begin(), old.end(), [&](const HashEntry& slot) { return insert(slot); });
+            }
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,224 @@
+#pragma once
+// Bucketized cuckoo join engine: every key lives in one of its two buckets, and a bucket is
+// one cache line of 8 entries, so a lookup reads at most two cache lines (three with
+// duplicates) and compares the 8 keys of a bucket with one AVX2 instruction.
+// With 8 ways the table runs at up to 90% load: inserts look for a free slot with a
+// breadth-first search over the eviction graph and move the keys on the shortest path.
+// A key with a single build row keeps it in its slot. Keys with duplicates point their slot
+// into the side chain: a header entry holding their count, followed by their entries (CSR).
+// Empty slots hold INT32_MIN, the NULL key, which never enters a join table.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <unchained_table.h>
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct BucketCuckooTable{
+        static constexpr size_t WAYS = 8;
+        static constexpr int32_t EMPTY_KEY = INT32_MIN;
+        static constexpr uint32_t DUPLICATES = 1u << 31; // slot row_idx: header position in chain (build rows stay below 2^31)
+        static constexpr double MAX_LOAD = 0.9;
+        static constexpr size_t MAX_SEARCH = 512;         // buckets a breadth-first search may visit before the table grows
+
+        struct alignas(64) Bucket{
+            HashEntry slots[WAYS];
+        };
+        static_assert(sizeof(Bucket) == 64);
+
+        // breadth-first search state: step i reached bucket through the key in slot parent_slot
+        // of the bucket of step parent
+        struct Step{
+            size_t bucket;
+            int32_t parent;
+            int32_t parent_slot;
+        };
+
+        std::vector<Bucket> buckets;
+        std::vector<HashEntry> chain; // keys with duplicates: header {key, count}, then their entries
+        std::vector<Step> steps;      // reused by every insert
+        size_t num_elements = 0;
+
+        void reserve(size_t build_size){
+            allocate(std::max<size_t>(2, static_cast<size_t>(static_cast<double>(build_size) / (WAYS * MAX_LOAD)) + 1));
+        }
+
+        // Multiply-shift maps the hash to any bucket count, so the table can be sized to the load factor
+        size_t bucket1(int32_t key) const{
+            return static_cast<size_t>((static_cast<uint64_t>(mix32(key)) * buckets.size()) >> 32);
+        }
+
+        size_t bucket2(int32_t key) const{
+            const uint32_t h = static_cast<uint32_t>((static_cast<uint64_t>(static_cast<uint32_t>(key)) * 0x9E3779B97F4A7C15ull) >> 32);
+            size_t b = static_cast<size_t>((static_cast<uint64_t>(h) * buckets.size()) >> 32);
+            if(b == bucket1(key)) b = b + 1 == buckets.size() ? 0 : b + 1;
+            return b;
+        }
+
+        size_t other_bucket(int32_t key, size_t bucket) const{
+            const size_t b1 = bucket1(key);
+            return b1 == bucket ? bucket2(key) : b1;
+        }
+
+        // Bit i set: slot i of the bucket holds key
+        static uint32_t match(const Bucket& bucket, int32_t key){
+#if defined(__AVX2__)
+            const __m256i needle = _mm256_set1_epi64x(static_cast<int64_t>(static_cast<uint32_t>(key)));
+            const __m256i mask = _mm256_set1_epi64x(0xFFFFFFFFll);
+            const __m256i lo = _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(bucket.slots)), mask);
+            const __m256i hi = _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(bucket.slots + 4)), mask);
+            const uint32_t lo_bits = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lo, needle))));
+            const uint32_t hi_bits = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(hi, needle))));
+            return lo_bits | (hi_bits << 4);
+#else
+            uint32_t bits = 0;
+            for(size_t i = 0; i < WAYS; ++i) bits |= static_cast<uint32_t>(bucket.slots[i].key == key) << i;
+            return bits;
+#endif
+        }
+
+        const HashEntry* find_entry(int32_t key) const{
+            if(key == EMPTY_KEY) return nullptr;
+            const size_t b1 = bucket1(key);
+            if(const uint32_t bits = match(buckets[b1], key)) return &buckets[b1].slots[__builtin_ctz(bits)];
+            const size_t b2 = bucket2(key);
+            if(const uint32_t bits = match(buckets[b2], key)) return &buckets[b2].slots[__builtin_ctz(bits)];
+            return nullptr;
+        }
+
+        // Pass 1 places the first row of every key and counts the others in its slot.
+        // Pass 2 (only when there are duplicates) fills the side chain.
+        template <typename EntryAt>
+        void build_parallel(size_t count, [[maybe_unused]] size_t threads, EntryAt&& entry_at){
+            HashEntry entry;
+            num_elements = 0;
+            bool duplicates = false;
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                ++num_elements;
+                if(auto* slot = const_cast<HashEntry*>(find_entry(entry.key))){
+                    slot->row_idx = (slot->row_idx & DUPLICATES) ? slot->row_idx + 1 : DUPLICATES | 2;
+                    duplicates = true;
+                    continue;
+                }
+                while(!insert(entry)) grow();
+            }
+            if(!duplicates) return;
+
+            // headers count up again while the entries are copied
+            chain.clear();
+            for(auto& bucket : buckets){
+                for(auto& slot : bucket.slots){
+                    if(slot.key == EMPTY_KEY || !(slot.row_idx & DUPLICATES)) continue;
+                    const uint32_t header = static_cast<uint32_t>(chain.size());
+                    chain.resize(chain.size() + 1 + (slot.row_idx & ~DUPLICATES));
+                    chain[header] = HashEntry(slot.key, 0);
+                    slot.row_idx = DUPLICATES | header;
+                }
+            }
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                const HashEntry* slot = find_entry(entry.key);
+                if(!(slot->row_idx & DUPLICATES)) continue;
+                HashEntry& header = chain[slot->row_idx & ~DUPLICATES];
+                (&header)[1 + header.row_idx++] = entry;
+            }
+        }
+
+        const HashEntry* find_range(int32_t key, size_t& len) const{
+            const HashEntry* slot = find_entry(key);
+            if(!slot){
+                len = 0;
+                return nullptr;
+            }
+            if(!(slot->row_idx & DUPLICATES)){
+                len = 1;
+                return slot;
+            }
+            const HashEntry* header = chain.data() + (slot->row_idx & ~DUPLICATES);
+            len = header->row_idx;
+            return header + 1;
+        }
+
+        size_t size() const{
+            return num_elements;
+        }
+
+        size_t bytes() const{
+            return buckets.size() * sizeof(Bucket) + chain.capacity() * sizeof(HashEntry);
+        }
+
+    private:
+        void allocate(size_t num_buckets){
+            buckets.assign(num_buckets, Bucket{});
+            for(auto& bucket : buckets){
+                for(auto& slot : bucket.slots) slot = HashEntry(EMPTY_KEY, 0);
+            }
+        }
+
+        // Places entry (a key not in the table yet); false when no eviction path was found
+        bool insert(const HashEntry& entry){
+            steps.clear();
+            steps.push_back({bucket1(entry.key), -1, -1});
+            steps.push_back({bucket2(entry.key), -1, -1});
+
+            for(size_t i = 0; i < steps.size(); ++i){
+                Bucket& bucket = buckets[steps[i].bucket];
+                if(const uint32_t free = match(bucket, EMPTY_KEY)){
+                    // shift the keys down the path, the root bucket takes the new key
+                    size_t target = steps[i].bucket;
+                    int32_t target_slot = __builtin_ctz(free);
+                    for(size_t step = i; steps[step].parent >= 0; step = static_cast<size_t>(steps[step].parent)){
+                        const Step& from = steps[static_cast<size_t>(steps[step].parent)];
+                        buckets[target].slots[target_slot] = buckets[from.bucket].slots[steps[step].parent_slot];
+                        target = from.bucket;
+                        target_slot = steps[step].parent_slot;
+                    }
+                    buckets[target].slots[target_slot] = entry;
+                    return true;
+                }
+                for(size_t slot = 0; slot < WAYS && steps.size() < MAX_SEARCH; ++slot){
+                    const size_t next = other_bucket(bucket.slots[slot].key, steps[i].bucket);
+                    if(!on_path(i, next)) steps.push_back({next, static_cast<int32_t>(i), static_cast<int32_t>(slot)});
+                }
+            }
+            return false;
+        }
+
+        // A path visits every bucket once, so no key is moved twice
+        bool on_path(size_t step, size_t bucket) const{
+            for(int64_t s = static_cast<int64_t>(step); s >= 0; s = steps[static_cast<size_t>(s)].parent){
+                if(steps[static_cast<size_t>(s)].bucket == bucket) return true;
+            }
+            return false;
+        }
+
+        // Doubles the buckets and reinserts every key with its row or count
+        void grow(){
+            std::vector<Bucket> old = std::move(buckets);
+            size_t num_buckets = old.size();
+            bool placed = false;
+            while(!placed){
+                num_buckets *= 2;
+                allocate(num_buckets);
+                placed = true;
+                for(const auto& bucket : old){
+                    for(const auto& slot : bucket.slots){
+                        if(slot.key != EMPTY_KEY && !insert(slot)) placed = false;
+                    }
+                    if(!placed) break;
+                }
+            }
+        }
+    };
+
+} // namespace jointable
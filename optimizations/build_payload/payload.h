@@ -0,0 +1,101 @@
+#pragma once
+// Build-side payload in the hash entries.
+// For a small build side with a few output columns, the entries carry the build-side
+// output values next to key and row index: a match reads everything it emits from the
+// build side out of one entry of 8 + 8 * columns bytes (up to MAX_COLUMNS = 4 columns,
+// 40 bytes; entries are packed, so from 2 columns on one may straddle two cache lines)
+// instead of one column page per output column.
+// SPC_PAYLOAD_MAX_BUILD sets the largest build side that gets a payload (0 disables it).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <plan.h>
+#include <value_t.h>
+#include <unchained_table.h>
+
+namespace payload{
+
+    constexpr size_t MAX_COLUMNS = 4;
+
+    template <size_t Width>
+    struct PayloadEntry{
+        int32_t key = 0;
+        uint32_t row_idx = 0;
+        valuet::value_t values[Width];
+    };
+
+    template <size_t Width>
+    using Table = BasicUnchainedTable<PayloadEntry<Width>>;
+
+    template <typename Entry>
+    constexpr bool has_payload = requires(const Entry& entry) { entry.values; };
+
+    inline size_t max_build_rows(){
+        static const size_t rows = [] {
+            size_t value = 65536;
+            if(const char* v = std::getenv("SPC_PAYLOAD_MAX_BUILD")){
+                char* end = nullptr;
+                const unsigned long parsed = std::strtoul(v, &end, 10);
+                if(end != v) value = parsed;
+            }
+            return value;
+        }();
+        return rows;
+    }
+
+    // Where the build-side output columns go in the payload
+    struct Layout{
+        std::vector<int32_t> slot_of_output; // payload slot of every output column, -1 for probe-side columns
+        std::vector<size_t> build_columns;   // build-side column of every payload slot
+    };
+
+    inline Layout layout(const std::vector<std::tuple<size_t, DataType>>& output_attrs, size_t left_columns, bool build_left){
+        Layout result;
+        result.slot_of_output.assign(output_attrs.size(), -1);
+        for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+            const size_t col_idx = std::get<0>(output_attrs[out_idx]);
+            if((col_idx < left_columns) != build_left) continue;
+            result.slot_of_output[out_idx] = static_cast<int32_t>(result.build_columns.size());
+            result.build_columns.push_back(build_left ? col_idx : col_idx - left_columns);
+        }
+        return result;
+    }
+
+    inline bool enabled(const Layout& layout, size_t build_rows){
+        return !layout.build_columns.empty() && layout.build_columns.size() <= MAX_COLUMNS && build_rows <= max_build_rows();
+    }
+
+    // Calls fn with std::integral_constant<size_t, width> for 1 <= width <= MAX_COLUMNS
+    template <typename Fn>
+    void with_width(size_t width, Fn&& fn){
+        switch(width){
+            case 1: fn(std::integral_constant<size_t, 1>{}); break;
+            case 2: fn(std::integral_constant<size_t, 2>{}); break;
+            case 3: fn(std::integral_constant<size_t, 3>{}); break;
+            default: fn(std::integral_constant<size_t, 4>{}); break;
+        }
+    }
+
+    // Builds the table from the build-side key column, copying the payload columns of every row
+    template <size_t Width, typename Columns>
+    void build(Table<Width>& table, const Columns& build_side, size_t key_col, const std::vector<size_t>& build_columns,
+               size_t build_size, size_t threads){
+        table.reserve(build_size);
+        table.build_parallel(build_size, threads, [&](size_t row_idx, PayloadEntry<Width>& entry) {
+            const auto& key = build_side[key_col][row_idx];
+            if(key.is_null_int32()) return false;
+            entry.key = key.intvalue;
+            entry.row_idx = static_cast<uint32_t>(row_idx);
+            for(size_t slot = 0; slot < Width; ++slot){
+                entry.values[slot] = build_side[build_columns[slot]][row_idx];
+            }
+            return true;
+        });
+    }
+
+} // namespace payload
@@ -0,0 +1,84 @@
+#pragma once
+// Count-then-scatter probing for high fanout joins.
+// The pair probe buffers a (left, right) row pair per match, 16 bytes each, and copies the
+// values in a second pass: with many matches per probe row the buffers outgrow the output.
+// Count-then-scatter buffers nothing per match. Pass 1 claims adaptive morsels and only
+// filters their keys: find_range (the Bloom tag of the unchained tables, the key lookup of
+// the open addressing engines) gives the length of the candidate range, no entry is read.
+// The lengths bound the matches of every morsel; a prefix sum over the bounds, in probe row
+// order, gives every morsel its output region, and pass 2 probes each morsel again and writes
+// its matches from the start of its region. Ranges of the unchained tables also hold other
+// keys of the same slot, so regions can end in unwritten rows: the rows written past the
+// total move down into those gaps and the output is cut to the total.
+// Match ranges above the skew threshold are written as slices on all threads, after the rows
+// of all morsels, and the gap moves reorder rows too: the output leaves probe row order.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+namespace scatter{
+
+    // Output rows [out, out + bound) of a morsel or a heavy slice, written from out on
+    struct Region{
+        size_t out = 0;
+        size_t bound = 0;
+        size_t written = 0;
+    };
+
+    // a morsel of pass 1: probe rows [begin, end) and their output region
+    struct Morsel{
+        size_t begin;
+        size_t end;
+        Region rows;
+    };
+
+    // rows [from, from + rows) of every output column go to [to, to + rows)
+    struct Move{
+        size_t from;
+        size_t to;
+        size_t rows;
+    };
+
+    // Fills the unwritten rows below the written total with the rows written above it.
+    // regions are in output order; sources never overlap targets (all sources are past the total)
+    inline std::vector<Move> fill_gaps(const std::vector<Region>& regions, size_t total){
+        std::vector<Move> moves;
+        size_t source = regions.size(); // region the rows above the total are taken from, back to front
+        size_t source_begin = 0, source_end = 0;
+        for(const Region& region : regions){
+            if(region.out >= total) break;
+            size_t gap = region.out + region.written;
+            const size_t gap_end = std::min(region.out + region.bound, total);
+            while(gap < gap_end){
+                while(source_begin == source_end){
+                    const Region& from = regions[--source];
+                    source_begin = std::max(from.out, total);
+                    source_end = std::max(source_begin, from.out + from.written);
+                }
+                const size_t rows = std::min(gap_end - gap, source_end - source_begin);
+                source_end -= rows;
+                moves.push_back({source_end, gap, rows});
+                gap += rows;
+            }
+        }
+        return moves;
+    }
+
+    // Estimated matches per probe row from which parallel probes count and scatter.
+    // SPC_SCATTER_FANOUT overrides it (0 always scatters).
+    inline double min_fanout(){
+        static const double fanout = [] {
+            double value = 4;
+            if(const char* v = std::getenv("SPC_SCATTER_FANOUT")){
+                char* end = nullptr;
+                const double parsed = std::strtod(v, &end);
+                if(end != v && parsed >= 0) value = parsed;
+            }
+            return value;
+        }();
+        return fanout;
+    }
+
+} // namespace scatter
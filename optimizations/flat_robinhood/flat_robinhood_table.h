@@ -0,0 +1,170 @@
+#pragma once
+// Flat Robin Hood join engine: 8 byte slots (key, row) and the probe sequence lengths in a
+// side byte array. A lookup walks the byte array and compares a key only where the stored
+// psl equals its own distance from home, and it stops at the first slot whose psl is
+// shorter than that distance (or that is empty).
+// Built in bulk: the entries are counting-sorted by home slot and placed in that order,
+// which gives the Robin Hood layout without any displacement. A key with a single build
+// row keeps it in its slot. Keys with duplicates point their slot into the row arena: a
+// header entry holding their count, followed by their entries.
+// find_ranges resolves a batch of keys with the slots of the whole batch prefetched first.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <unchained_table.h>
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct FlatRobinHoodTable{
+        static constexpr uint32_t DUPLICATES = 1u << 31; // slot row_idx: header position in arena (build rows stay below 2^31)
+        static constexpr size_t MAX_PSL = 254;            // psl bytes store psl + 1, 0 is an empty slot
+        static constexpr size_t BATCH = 16;
+
+        std::vector<HashEntry> slots;  // capacity + MAX_PSL: runs past the last home slot never wrap
+        std::vector<uint8_t> psl;
+        std::vector<HashEntry> arena;  // keys with duplicates: header {key, count}, then their entries
+        size_t capacity = 0;
+        unsigned shift = 64;
+        size_t num_elements = 0;
+
+        void reserve(size_t build_size){
+            capacity = next_pow2(std::max<size_t>(16, build_size + build_size / 4)); // load factor at most 0.8
+            shift = 64 - static_cast<unsigned>(__builtin_ctzll(capacity));
+        }
+
+        size_t home(int32_t key) const{
+            return static_cast<size_t>(UnchainedHashTable::hash(key) >> shift);
+        }
+
+        template <typename EntryAt>
+        void build_parallel(size_t count, [[maybe_unused]] size_t threads, EntryAt&& entry_at){
+            // counting sort of the entries by home slot
+            std::vector<uint32_t> offsets(capacity + 1, 0);
+            HashEntry entry;
+            num_elements = 0;
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                offsets[home(entry.key) + 1]++;
+                ++num_elements;
+            }
+            for(size_t h = 0; h < capacity; ++h) offsets[h + 1] += offsets[h];
+            std::vector<HashEntry> sorted(num_elements);
+            {
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for(size_t i = 0; i < count; ++i){
+                    if(entry_at(i, entry)) sorted[cursor[home(entry.key)]++] = entry;
+                }
+            }
+
+            // grow in the rare case a run gets longer than a psl byte can hold
+            while(!place(sorted, offsets)){
+                capacity *= 2;
+                shift--;
+                offsets.assign(capacity + 1, 0);
+                for(const auto& e : sorted) offsets[home(e.key) + 1]++;
+                for(size_t h = 0; h < capacity; ++h) offsets[h + 1] += offsets[h];
+                std::vector<HashEntry> resorted(sorted.size());
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for(const auto& e : sorted) resorted[cursor[home(e.key)]++] = e;
+                sorted.swap(resorted);
+            }
+        }
+
+        const HashEntry* find_range(int32_t key, size_t& len) const{
+            size_t pos = home(key);
+            for(uint8_t dist = 1;; ++dist, ++pos){
+                const uint8_t stored = psl[pos];
+                if(stored < dist) break; // empty or a key closer to home: key is absent
+                if(stored == dist && slots[pos].key == key) return range_of(slots[pos], len);
+            }
+            len = 0;
+            return nullptr;
+        }
+
+        // Batched probe: ranges[i], lens[i] as find_range(keys[i], lens[i]) would return them
+        void find_ranges(const int32_t* keys, size_t count, const HashEntry** ranges, size_t* lens) const{
+            size_t homes[BATCH];
+            for(size_t begin = 0; begin < count; begin += BATCH){
+                const size_t n = std::min(BATCH, count - begin);
+                for(size_t i = 0; i < n; ++i){
+                    homes[i] = home(keys[begin + i]);
+                    __builtin_prefetch(&psl[homes[i]]);
+                    __builtin_prefetch(&slots[homes[i]]);
+                }
+                for(size_t i = 0; i < n; ++i){
+                    const int32_t key = keys[begin + i];
+                    ranges[begin + i] = nullptr;
+                    lens[begin + i] = 0;
+                    size_t pos = homes[i];
+                    for(uint8_t dist = 1;; ++dist, ++pos){
+                        const uint8_t stored = psl[pos];
+                        if(stored < dist) break;
+                        if(stored == dist && slots[pos].key == key){
+                            ranges[begin + i] = range_of(slots[pos], lens[begin + i]);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        size_t size() const{
+            return num_elements;
+        }
+
+        size_t bytes() const{
+            return slots.capacity() * (sizeof(HashEntry) + 1) + arena.capacity() * sizeof(HashEntry);
+        }
+
+    private:
+        const HashEntry* range_of(const HashEntry& slot, size_t& len) const{
+            if(!(slot.row_idx & DUPLICATES)){
+                len = 1;
+                return &slot;
+            }
+            const HashEntry* header = arena.data() + (slot.row_idx & ~DUPLICATES);
+            len = header->row_idx;
+            return header + 1;
+        }
+
+        // Places the distinct keys of sorted (grouped by home) in home order; false when a psl overflows
+        bool place(std::vector<HashEntry>& sorted, const std::vector<uint32_t>& offsets){
+            slots.assign(capacity + MAX_PSL + 1, HashEntry{});
+            psl.assign(capacity + MAX_PSL + 1, 0);
+            arena.clear();
+            size_t next = 0; // first free slot
+            for(size_t h = 0; h < capacity; ++h){
+                // equal keys next to each other within the home slot
+                auto first = sorted.begin() + offsets[h], last = sorted.begin() + offsets[h + 1];
+                if(last - first > 1){
+                    std::sort(first, last, [](const HashEntry& a, const HashEntry& b) { return a.key < b.key; });
+                }
+                while(first != last){
+                    auto run_end = first + 1;
+                    while(run_end != last && run_end->key == first->key) ++run_end;
+
+                    const size_t pos = std::max(next, h);
+                    if(pos - h >= MAX_PSL) return false;
+                    psl[pos] = static_cast<uint8_t>(pos - h + 1);
+                    if(run_end - first == 1){
+                        slots[pos] = *first;
+                    }
+                    else{
+                        const uint32_t header = static_cast<uint32_t>(arena.size());
+                        arena.push_back(HashEntry(first->key, static_cast<size_t>(run_end - first)));
+                        arena.insert(arena.end(), first, run_end);
+                        slots[pos] = HashEntry(first->key, DUPLICATES | header);
+                    }
+                    next = pos + 1;
+                    first = run_end;
+                }
+            }
+            return true;
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,143 @@
+#pragma once
+// Hash table engines of the join and their selection.
+// Every engine models JoinTable, so the probe and materialize code is shared:
+//   reserve(build_rows)                       allocate for up to build_rows entries
+//   build_parallel(count, threads, entry_at)  entry_at(i, HashEntry&) fills entry i, false skips it
+//   find_range(key, len)                      contiguous entries that may match key (len of them,
+//                                             nullptr when none); callers compare entry.key
+//   size()                                    entries in the table
+// SPC_JOIN_ENGINE picks the engine: "robinhood" for every join, or a default followed by
+// per join node choices, e.g. "unchained,3=cuckoo,5=hopscotch" (node indexes of the plan).
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <unchained_table.h>
+#include <robinhood_table.h>
+#include <cuckoo_table.h>
+#include <hopscotch_table.h>
+#include <swiss_table.h>
+#include <bucket_cuckoo_table.h>
+#include <flat_robinhood_table.h>
+
+namespace jointable{
+
+    template <typename T>
+    concept JoinTable = std::default_initializable<T> &&
+        requires(T table, const T& built, size_t rows, int32_t key, size_t& len, bool (*entry_at)(size_t, HashEntry&)) {
+            table.reserve(rows);
+            table.build_parallel(rows, rows, entry_at);
+            { built.find_range(key, len) } -> std::same_as<const HashEntry*>;
+            { built.size() } -> std::convertible_to<size_t>;
+        };
+
+    static_assert(JoinTable<UnchainedHashTable>);
+    static_assert(JoinTable<RobinHoodTable>);
+    static_assert(JoinTable<CuckooTable>);
+    static_assert(JoinTable<HopscotchTable>);
+    static_assert(JoinTable<SwissTable>);
+    static_assert(JoinTable<BucketCuckooTable>);
+    static_assert(JoinTable<FlatRobinHoodTable>);
+
+    enum class Engine{ unchained, robinhood, cuckoo, hopscotch, swiss, bucket_cuckoo, flat_robinhood };
+
+    constexpr Engine ENGINES[] = {Engine::unchained, Engine::robinhood, Engine::cuckoo, Engine::hopscotch,
+                                  Engine::swiss, Engine::bucket_cuckoo, Engine::flat_robinhood};
+
+    inline const char* name(Engine engine){
+        switch(engine){
+            case Engine::robinhood:      return "robinhood";
+            case Engine::cuckoo:         return "cuckoo";
+            case Engine::hopscotch:      return "hopscotch";
+            case Engine::swiss:          return "swiss";
+            case Engine::bucket_cuckoo:  return "bucket_cuckoo";
+            case Engine::flat_robinhood: return "flat_robinhood";
+            default:                     return "unchained";
+        }
+    }
+
+    inline bool parse_engine(std::string_view text, Engine& engine){
+        for(Engine candidate : ENGINES){
+            if(text == name(candidate)){
+                engine = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Engine of every join: a default and overrides by join node index
+    struct Selection{
+        Engine fallback = Engine::unchained;
+        std::vector<std::pair<size_t, Engine>> per_node;
+
+        Engine for_node(size_t node_idx) const{
+            for(const auto& [node, engine] : per_node){
+                if(node == node_idx) return engine;
+            }
+            return fallback;
+        }
+    };
+
+    // Parses SPC_JOIN_ENGINE, unknown parts are reported and ignored
+    inline Selection parse_selection(std::string_view text){
+        Selection selection;
+        while(!text.empty()){
+            const size_t comma = text.find(',');
+            const std::string_view part = text.substr(0, comma);
+            text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+            if(part.empty()) continue;
+
+            Engine engine;
+            const size_t eq = part.find('=');
+            if(eq == std::string_view::npos){
+                if(parse_engine(part, engine)) selection.fallback = engine;
+                else std::cerr << "SPC_JOIN_ENGINE: unknown engine " << part << std::endl;
+                continue;
+            }
+            const std::string node(part.substr(0, eq));
+            char* end = nullptr;
+            const unsigned long node_idx = std::strtoul(node.c_str(), &end, 10);
+            if(end == node.c_str() || *end || !parse_engine(part.substr(eq + 1), engine)){
+                std::cerr << "SPC_JOIN_ENGINE: cannot parse " << part << std::endl;
+                continue;
+            }
+            selection.per_node.emplace_back(node_idx, engine);
+        }
+        return selection;
+    }
+
+    // Calls fn with an empty table of the engine
+    template <typename Fn>
+    void with_table(Engine engine, Fn&& fn){
+        switch(engine){
+            case Engine::robinhood:      { RobinHoodTable table; fn(table); break; }
+            case Engine::cuckoo:         { CuckooTable table; fn(table); break; }
+            case Engine::hopscotch:      { HopscotchTable table; fn(table); break; }
+            case Engine::swiss:          { SwissTable table; fn(table); break; }
+            case Engine::bucket_cuckoo:  { BucketCuckooTable table; fn(table); break; }
+            case Engine::flat_robinhood: { FlatRobinHoodTable table; fn(table); break; }
+            default:                     { UnchainedHashTable table; fn(table); break; }
+        }
+    }
+
+    // Builds table from a key column, NULL keys stay out
+    template <JoinTable Table, typename Column>
+    void build(Table& table, const Column& keys, size_t build_size, size_t threads){
+        table.reserve(build_size);
+        table.build_parallel(build_size, threads, [&](size_t row_idx, HashEntry& entry) {
+            const auto& key = keys[row_idx];
+            if(key.is_null_int32()) return false;
+            entry = HashEntry(key.intvalue, row_idx);
+            return true;
+        });
+    }
+
+} // namespace jointable
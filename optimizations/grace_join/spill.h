@@ -0,0 +1,238 @@
+#pragma once
+// Out-of-core (grace) hash join.
+// When the build side of a join does not fit the per-query memory budget, the
+// (key, row) pairs of both sides are hash partitioned into temporary files and
+// the join runs one partition at a time. Partitions that are still too large are
+// repartitioned with the next hash bits; a partition that cannot be split any
+// further (a single heavy key) is joined in build chunks that fit the budget.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <threaded_table.h>
+#include <unchained_table.h>
+
+namespace spill{
+
+    constexpr size_t FANOUT_BITS = 4;        // 16 partitions per repartitioning level
+    constexpr size_t MAX_PARTITION_BITS = 21; // bits above 21 are used by the bloom tags
+    constexpr size_t WRITE_BUFFER_TUPLES = 4096;
+
+    struct SpillTuple{
+        int32_t key;
+        uint32_t unused;
+        uint64_t row_idx;
+    };
+
+    inline size_t env_size(const char* name){
+        const char* s = std::getenv(name);
+        if (!s || !*s) return 0;
+        char* end = nullptr;
+        unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s) return 0;
+        return static_cast<size_t>(v);
+    }
+
+    // 0 => spilling disabled
+    inline size_t memory_budget_bytes(){
+        return env_size("SPC_JOIN_MEMORY_MB") << 20;
+    }
+
+    inline std::string spill_dir(){
+        if(const char* dir = std::getenv("SPC_SPILL_DIR"); dir && *dir) return dir;
+        if(const char* dir = std::getenv("TMPDIR"); dir && *dir) return dir;
+        return "/tmp";
+    }
+
+    // Memory of an in-memory build: collected tuples, final tuple storage and directory
+    inline size_t build_footprint(size_t build_rows){
+        size_t capacity = 1024;
+        while(capacity < build_rows) capacity *= 2;
+        return build_rows * 2 * sizeof(threaded::HashEntry) + capacity * sizeof(uint64_t);
+    }
+
+    inline uint64_t partition_of(int32_t key, size_t bit_offset){
+        // low hash bits: the top ones pick the directory slot, bits 21+ the bloom tag
+        return (threaded::HashEntry::compute_hash(key) >> bit_offset) & ((1u << FANOUT_BITS) - 1);
+    }
+
+    // Unlinked temporary file: written through a buffer, read back with mmap
+    struct SpillFile{
+        int fd = -1;
+        size_t count = 0;
+        std::vector<SpillTuple> buffer;
+
+        explicit SpillFile(const std::string& dir){
+            std::string path = dir + "/spc_spill_XXXXXX";
+            fd = mkstemp(path.data());
+            if(fd < 0) throw std::runtime_error("spill: cannot create temp file in " + dir + ": " + std::strerror(errno));
+            unlink(path.c_str()); // removed from disk as soon as it is closed
+            buffer.reserve(WRITE_BUFFER_TUPLES);
+        }
+
+        ~SpillFile(){
+            if(fd >= 0) close(fd);
+        }
+
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        void append(int32_t key, uint64_t row_idx){
+            buffer.push_back(SpillTuple{key, 0, row_idx});
+            if(buffer.size() == WRITE_BUFFER_TUPLES) flush();
+        }
+
+        void flush(){
+            const char* data = reinterpret_cast<const char*>(buffer.data());
+            size_t bytes = buffer.size() * sizeof(SpillTuple);
+            while(bytes > 0){
+                ssize_t written = write(fd, data, bytes);
+                if(written < 0){
+                    if(errno == EINTR) continue;
+                    throw std::runtime_error(std::string("spill: write failed: ") + std::strerror(errno));
+                }
+                data += written;
+                bytes -= static_cast<size_t>(written);
+            }
+            count += buffer.size();
+            buffer.clear();
+        }
+
+        // Read-only view of a finished file
+        struct Mapping{
+            void* addr = nullptr;
+            size_t bytes = 0;
+            const SpillTuple* tuples = nullptr;
+            size_t count = 0;
+
+            Mapping() = default;
+            Mapping(const Mapping&) = delete;
+            Mapping& operator=(const Mapping&) = delete;
+            ~Mapping(){
+                if(addr) munmap(addr, bytes);
+            }
+        };
+
+        std::unique_ptr<Mapping> map(){
+            flush();
+            auto mapping = std::make_unique<Mapping>();
+            mapping->count = count;
+            if(count == 0) return mapping;
+
+            mapping->bytes = count * sizeof(SpillTuple);
+            mapping->addr = mmap(nullptr, mapping->bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping->addr == MAP_FAILED){
+                mapping->addr = nullptr;
+                throw std::runtime_error(std::string("spill: mmap failed: ") + std::strerror(errno));
+            }
+            madvise(mapping->addr, mapping->bytes, MADV_SEQUENTIAL);
+            mapping->tuples = static_cast<const SpillTuple*>(mapping->addr);
+            return mapping;
+        }
+    };
+
+    using PartitionFiles = std::vector<std::unique_ptr<SpillFile>>;
+
+    inline PartitionFiles make_partition_files(const std::string& dir){
+        PartitionFiles files;
+        files.reserve(size_t(1) << FANOUT_BITS);
+        for(size_t p = 0; p < (size_t(1) << FANOUT_BITS); ++p){
+            files.push_back(std::make_unique<SpillFile>(dir));
+        }
+        return files;
+    }
+
+    inline PartitionFiles repartition(SpillFile& file, size_t bit_offset, const std::string& dir){
+        PartitionFiles parts = make_partition_files(dir);
+        auto mapping = file.map();
+        for(size_t i = 0; i < mapping->count; ++i){
+            const SpillTuple& t = mapping->tuples[i];
+            parts[partition_of(t.key, bit_offset)]->append(t.key, t.row_idx);
+        }
+        return parts;
+    }
+
+    // emit(build_row, probe_row) for every match of one build/probe partition pair
+    template <typename Emit>
+    void join_partition(SpillFile& build, SpillFile& probe, size_t bit_offset, size_t budget, const std::string& dir, Emit& emit){
+        build.flush();
+        probe.flush();
+        if(build.count == 0 || probe.count == 0) return;
+
+        // still too large: split both sides with the next hash bits
+        if(build_footprint(build.count) > budget && bit_offset + FANOUT_BITS <= MAX_PARTITION_BITS){
+            PartitionFiles build_parts = repartition(build, bit_offset, dir);
+            PartitionFiles probe_parts = repartition(probe, bit_offset, dir);
+            for(size_t p = 0; p < build_parts.size(); ++p){
+                join_partition(*build_parts[p], *probe_parts[p], bit_offset + FANOUT_BITS, budget, dir, emit);
+            }
+            return;
+        }
+
+        // skewed partition: hash bits cannot split it, so join it in build chunks that fit
+        size_t chunk_rows = build.count;
+        while(chunk_rows > 1 && build_footprint(chunk_rows) > budget) chunk_rows /= 2;
+
+        auto build_map = build.map();
+        auto probe_map = probe.map();
+        for(size_t chunk_start = 0; chunk_start < build_map->count; chunk_start += chunk_rows){
+            const size_t chunk_end = std::min(chunk_start + chunk_rows, build_map->count);
+
+            ::UnchainedHashTable ht;
+            ht.reserve(chunk_end - chunk_start);
+            for(size_t i = chunk_start; i < chunk_end; ++i){
+                ht.insert(build_map->tuples[i].key, build_map->tuples[i].row_idx);
+            }
+            ht.finalize();
+
+            for(size_t i = 0; i < probe_map->count; ++i){
+                const SpillTuple& t = probe_map->tuples[i];
+                size_t len = 0;
+                const ::HashEntry* entries = ht.find_range(t.key, len);
+                if(!entries || len == 0) continue;
+                for(size_t e = 0; e < len; ++e){
+                    if(entries[e].key != t.key) continue;
+                    emit(entries[e].row_idx, static_cast<size_t>(t.row_idx));
+                }
+            }
+        }
+    }
+
+    // Grace hash join over two key columns (column_t-like: size() and operator[]).
+    // Matches are emitted serially, partition by partition.
+    template <typename KeyColumn, typename Emit>
+    void grace_join(const KeyColumn& build_keys, const KeyColumn& probe_keys, size_t budget, Emit emit){
+        const std::string dir = spill_dir();
+
+        PartitionFiles build_parts = make_partition_files(dir);
+        for(size_t row_idx = 0; row_idx < build_keys.size(); ++row_idx){
+            const auto& key = build_keys[row_idx];
+            if(key.is_null_int32()) continue;
+            build_parts[partition_of(key.intvalue, 0)]->append(key.intvalue, row_idx);
+        }
+
+        PartitionFiles probe_parts = make_partition_files(dir);
+        for(size_t row_idx = 0; row_idx < probe_keys.size(); ++row_idx){
+            const auto& key = probe_keys[row_idx];
+            if(key.is_null_int32()) continue;
+            probe_parts[partition_of(key.intvalue, 0)]->append(key.intvalue, row_idx);
+        }
+
+        for(size_t p = 0; p < build_parts.size(); ++p){
+            join_partition(*build_parts[p], *probe_parts[p], FANOUT_BITS, budget, dir, emit);
+        }
+    }
+
+} // namespace spill
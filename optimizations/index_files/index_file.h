@@ -0,0 +1,342 @@
+#pragma once
+// Prebuilt hash indexes persisted to disk.
+// A finalized unchained table (FinalTable or UnchainedHashTable) is written with
+// its directory holding byte offsets into the tuple storage instead of absolute
+// pointers, so the file can be mapped anywhere and probed in place.
+//
+// layout:
+//   [IndexHeader] padded to PAGE_SIZE
+//   [directory: capacity + 1 words, word 0 = 0] padded to PAGE_SIZE
+//   [entries: num_entries x ::HashEntry]
+//
+// The header records the identity of the indexed column (row count, page count
+// and a fingerprint of its values), so an index is only used on the data it was built from.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <plan.h>
+#include <table.h>
+#include <column_t.h>
+#include <threaded_table.h>
+#include <unchained_table.h>
+
+namespace indexfile{
+
+    constexpr char MAGIC[8] = {'S', 'P', 'C', 'I', 'N', 'D', 'E', 'X'};
+    constexpr uint32_t VERSION = 1;
+    constexpr int32_t HASH_CHECK_KEY = 0x5bd1e995;
+
+    // Identity of an indexed INT32 input column
+    struct SourceIdentity{
+        uint64_t num_rows;
+        uint64_t num_pages;
+        uint64_t fingerprint;
+
+        bool operator==(const SourceIdentity& other) const{
+            return num_rows == other.num_rows && num_pages == other.num_pages && fingerprint == other.fingerprint;
+        }
+    };
+
+    struct IndexHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_size;
+        uint64_t hash_check;  // hash of HASH_CHECK_KEY: catches a different hash function
+        uint64_t shift;       // slot = hash >> shift
+        uint64_t capacity;
+        uint64_t num_entries;
+        uint64_t directory_offset;
+        uint64_t entries_offset;
+        SourceIdentity source;
+    };
+
+    inline size_t round_to_page(size_t bytes){
+        return (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    }
+
+    inline uint64_t crc_step(uint64_t crc, uint64_t word){
+        #if defined(__x86_64__)
+            return __builtin_ia32_crc32di(crc, word);
+        #elif defined(__aarch64__)
+            return __builtin_arm_crc32d(static_cast<uint32_t>(crc), word);
+        #else
+            return (crc ^ word) * 0x9E3779B97F4A7C15ull;
+        #endif
+    }
+
+    inline uint64_t crc_bytes(uint64_t crc, const std::byte* data, size_t bytes){
+        size_t i = 0;
+        for(; i + 8 <= bytes; i += 8){
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            crc = crc_step(crc, word);
+        }
+        if(i < bytes){
+            uint64_t word = 0;
+            memcpy(&word, data + i, bytes - i);
+            crc = crc_step(crc, word);
+        }
+        return crc;
+    }
+
+    // Fingerprint over the meaningful bytes of every page (header, values, bitmap),
+    // so unused page space does not change the identity of the data.
+    inline SourceIdentity identify(const Column& column, size_t num_rows){
+        uint64_t low = 0, high = ~0ull;
+        for(const auto* page : column.pages){
+            const std::byte* data = page->data;
+            uint16_t page_rows = *reinterpret_cast<const uint16_t*>(data);
+            uint16_t page_values = *reinterpret_cast<const uint16_t*>(data + 2);
+            size_t bitmap_bytes = (page_rows + 7) / 8;
+            low = crc_bytes(low, data, 4 + page_values * sizeof(int32_t));
+            high = crc_bytes(high, data + PAGE_SIZE - bitmap_bytes, bitmap_bytes);
+        }
+        return SourceIdentity{num_rows, column.pages.size(), (low << 32) | (high & 0xffffffffull)};
+    }
+
+    inline void write_all(int fd, const void* data, size_t bytes, const std::string& path){
+        const char* ptr = static_cast<const char*>(data);
+        while(bytes > 0){
+            ssize_t written = write(fd, ptr, bytes);
+            if(written < 0){
+                if(errno == EINTR) continue;
+                throw std::runtime_error("indexfile: write to " + path + " failed: " + std::strerror(errno));
+            }
+            ptr += written;
+            bytes -= static_cast<size_t>(written);
+        }
+    }
+
+    // Write a finalized FinalTable or UnchainedHashTable
+    template <typename Table>
+    void write_index(const Table& table, const SourceIdentity& source, const std::string& path){
+        using Entry = std::remove_cv_t<std::remove_pointer_t<decltype(table.find_range(int32_t{}, std::declval<size_t&>()))>>;
+
+        const uint64_t capacity = 1ull << (64 - table.shift);
+        const uint64_t* directory = table.directory;
+
+        // entries are stored as ::HashEntry whatever the table, padding zeroed
+        std::vector<::HashEntry> entries(table.size());
+        memset(static_cast<void*>(entries.data()), 0, entries.size() * sizeof(::HashEntry));
+
+        // relocatable directory: byte offset of the end of every slot + its bloom tag
+        std::vector<uint64_t> out_directory(capacity + 1, 0);
+        size_t count = 0;
+        for(uint64_t slot = 0; slot < capacity; ++slot){
+            const Entry* start = reinterpret_cast<const Entry*>(directory[static_cast<int64_t>(slot) - 1] >> 16);
+            const Entry* end = reinterpret_cast<const Entry*>(directory[slot] >> 16);
+            for(const Entry* entry = start; entry < end; ++entry){
+                entries[count].key = entry->key;
+                entries[count].row_idx = entry->row_idx;
+                ++count;
+            }
+            out_directory[slot + 1] = (static_cast<uint64_t>(count * sizeof(::HashEntry)) << 16) | static_cast<uint16_t>(directory[slot]);
+        }
+        if(count != entries.size()){
+            throw std::runtime_error("indexfile: table directory does not cover its " + std::to_string(entries.size()) + " entries");
+        }
+
+        std::vector<std::byte> header_page(PAGE_SIZE);
+        IndexHeader header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.entry_size = sizeof(::HashEntry);
+        header.hash_check = ::UnchainedHashTable::hash(HASH_CHECK_KEY);
+        header.shift = table.shift;
+        header.capacity = capacity;
+        header.num_entries = count;
+        header.directory_offset = PAGE_SIZE;
+        header.entries_offset = PAGE_SIZE + round_to_page(out_directory.size() * sizeof(uint64_t));
+        header.source = source;
+        memcpy(header_page.data(), &header, sizeof(IndexHeader));
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) throw std::runtime_error("indexfile: cannot create " + path + ": " + std::strerror(errno));
+        try{
+            std::vector<std::byte> padding(PAGE_SIZE);
+            const size_t directory_bytes = out_directory.size() * sizeof(uint64_t);
+            write_all(fd, header_page.data(), header_page.size(), path);
+            write_all(fd, out_directory.data(), directory_bytes, path);
+            write_all(fd, padding.data(), round_to_page(directory_bytes) - directory_bytes, path);
+            write_all(fd, entries.data(), entries.size() * sizeof(::HashEntry), path);
+        } catch(...){
+            close(fd);
+            throw;
+        }
+        close(fd);
+    }
+
+    // Build and persist the index of an INT32 input column (offline, e.g. after the nightly load)
+    inline void build_index_file(const ColumnarTable& table, size_t column_idx, const std::string& path){
+        columnt::column_t keys;
+        keys.reference_column(table, column_idx, 0);
+
+        ::UnchainedHashTable hash_table;
+        hash_table.reserve(keys.size());
+        for(size_t row_idx = 0; row_idx < keys.size(); ++row_idx){
+            const auto& key = keys[row_idx];
+            if(key.is_null_int32()) continue;
+            hash_table.insert(key.intvalue, row_idx);
+        }
+        hash_table.finalize();
+
+        write_index(hash_table, identify(table.columns[column_idx], table.num_rows), path);
+    }
+
+    // A mapped index file, probed in place like the table it was written from
+    struct MappedIndex{
+        void* addr = nullptr;
+        size_t bytes = 0;
+        IndexHeader header{};
+        const uint64_t* directory = nullptr; // directory[-1] is the 0 offset sentinel
+        const std::byte* entries = nullptr;
+        uint64_t shift = 0;
+
+        MappedIndex() = default;
+        MappedIndex(const MappedIndex&) = delete;
+        MappedIndex& operator=(const MappedIndex&) = delete;
+
+        ~MappedIndex(){
+            if(addr) munmap(addr, bytes);
+        }
+
+        const ::HashEntry* find_range(int32_t key, size_t& len) const{
+            uint64_t h = ::UnchainedHashTable::hash(key);
+            uint64_t slot = h >> shift;
+
+            // Bloom filter check
+            uint16_t bloom = static_cast<uint16_t>(directory[slot]);
+            uint16_t tag = tags[(static_cast<uint32_t>(h) >> 21) & 0x7FF];
+            if((tag & ~bloom) != 0){
+                len = 0;
+                return nullptr;
+            }
+
+            const auto* start = reinterpret_cast<const ::HashEntry*>(entries + (directory[static_cast<int64_t>(slot) - 1] >> 16));
+            const auto* end = reinterpret_cast<const ::HashEntry*>(entries + (directory[slot] >> 16));
+            len = end - start;
+            return start;
+        }
+
+        size_t size() const { return header.num_entries; }
+    };
+
+    inline std::unique_ptr<MappedIndex> load_index(const std::string& path){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw std::runtime_error("indexfile: cannot open " + path + ": " + std::strerror(errno));
+
+        struct stat st;
+        if(fstat(fd, &st) != 0){
+            close(fd);
+            throw std::runtime_error("indexfile: cannot stat " + path + ": " + std::strerror(errno));
+        }
+        const size_t bytes = static_cast<size_t>(st.st_size);
+        if(bytes < PAGE_SIZE){
+            close(fd);
+            throw std::runtime_error("indexfile: " + path + " is truncated");
+        }
+
+        auto index = std::make_unique<MappedIndex>();
+        index->addr = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(index->addr == MAP_FAILED){
+            index->addr = nullptr;
+            throw std::runtime_error("indexfile: mmap of " + path + " failed: " + std::strerror(errno));
+        }
+        index->bytes = bytes;
+
+        const auto* base = static_cast<const std::byte*>(index->addr);
+        IndexHeader& header = index->header;
+        memcpy(&header, base, sizeof(IndexHeader));
+        if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.entry_size != sizeof(::HashEntry)){
+            throw std::runtime_error("indexfile: " + path + " has a bad magic, version or entry size");
+        }
+        if(header.hash_check != ::UnchainedHashTable::hash(HASH_CHECK_KEY)){
+            throw std::runtime_error("indexfile: " + path + " was built with a different hash function");
+        }
+        if(header.shift == 0 || header.shift >= 64 || header.capacity != (1ull << (64 - header.shift)) ||
+           header.directory_offset + (header.capacity + 1) * sizeof(uint64_t) > header.entries_offset ||
+           header.entries_offset + header.num_entries * sizeof(::HashEntry) != bytes){
+            throw std::runtime_error("indexfile: " + path + " is corrupt or truncated");
+        }
+
+        index->directory = reinterpret_cast<const uint64_t*>(base + header.directory_offset) + 1;
+        index->entries = base + header.entries_offset;
+        index->shift = header.shift;
+
+        // every slot range must lie inside the entries: offsets start at 0, never decrease,
+        // fall on entry boundaries and end at the last entry
+        const uint64_t entries_bytes = header.num_entries * sizeof(::HashEntry);
+        uint64_t previous = index->directory[-1] >> 16;
+        bool consistent = previous == 0;
+        for(uint64_t slot = 0; slot < header.capacity && consistent; ++slot){
+            const uint64_t offset = index->directory[slot] >> 16;
+            consistent = offset >= previous && offset <= entries_bytes && offset % sizeof(::HashEntry) == 0;
+            previous = offset;
+        }
+        if(!consistent || previous != entries_bytes){
+            throw std::runtime_error("indexfile: " + path + " has an inconsistent directory");
+        }
+        return index;
+    }
+
+    // Fingerprints of input columns, keyed by their first page, so a column is read once and
+    // not on every join. Columns of tables the context maps are identified in build_context
+    // and kept (their pages stay put until the context goes). Other inputs belong to one
+    // plan, their page addresses may be reused by the next: they are dropped per query.
+    struct IdentityCache{
+        struct Identified{
+            SourceIdentity identity;
+            bool persistent;
+        };
+        std::unordered_map<const Page*, Identified> columns;
+
+        const SourceIdentity& get(const Column& column, size_t num_rows, bool persistent = false){
+            auto it = columns.find(column.pages.front());
+            if(it == columns.end() || it->second.identity.num_rows != num_rows || it->second.identity.num_pages != column.pages.size()){
+                it = columns.insert_or_assign(column.pages.front(), Identified{identify(column, num_rows), persistent}).first;
+            }
+            return it->second.identity;
+        }
+
+        void begin_query(){
+            std::erase_if(columns, [](const auto& column) { return !column.second.persistent; });
+        }
+    };
+
+    // Could one of the indexes have been built from a column of this size (no fingerprint read)
+    inline bool may_match(const std::vector<std::unique_ptr<MappedIndex>>& indexes, const Column& column, size_t num_rows){
+        for(const auto& index : indexes){
+            if(index->header.source.num_rows == num_rows && index->header.source.num_pages == column.pages.size()) return true;
+        }
+        return false;
+    }
+
+    // Index built over the input column a scan references, if any
+    inline const MappedIndex* find_index(const std::vector<std::unique_ptr<MappedIndex>>& indexes, IdentityCache& identities,
+                                         const columnt::column_t& key_column){
+        if(indexes.empty() || !key_column.ref || key_column.ref->type != DataType::INT32 || key_column.ref->pages.empty()) return nullptr;
+        if(!may_match(indexes, *key_column.ref, key_column.size())) return nullptr;
+
+        const SourceIdentity& identity = identities.get(*key_column.ref, key_column.size());
+        for(const auto& index : indexes){
+            if(index->header.source == identity) return index.get();
+        }
+        return nullptr;
+    }
+
+} // namespace indexfile
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <common.h>
+#include <inner_column.h>
+
+#include <plan.h>
+#include <table.h>
+#include <value_t.h>
+#include <column_t.h>
+
+namespace mycopyscan{
+
+    inline std::vector<columnt::column_t> copy_scan_value_t(const ColumnarTable& table,
+        const std::vector<std::tuple<size_t, DataType>>& output_attrs, uint8_t table_id){
+        std::vector<columnt::column_t> results;
+        results.resize(output_attrs.size());
+
+        // Nothing is copied: INT32 and VARCHAR columns are both referenced in place.
+        // Dense pages are read directly, sparse pages only get a rank index over their bitmap
+        // and string values are synthesized as NewString on access.
+        auto task = [&](size_t begin, size_t end) {
+            for (size_t column_idx = begin; column_idx < end; ++column_idx) {
+                size_t in_col_idx = std::get<0>(output_attrs[column_idx]);
+                results[column_idx].reference_column(table, in_col_idx, table_id);
+            }
+        };
+        filter_tp.run(task, output_attrs.size());
+        return results;
+    }
+
+} // namespace mycopyscan
\ No newline at end of file
@@ -0,0 +1,241 @@
+#pragma once
+// Native on-disk format for input ColumnarTables.
+// The file is a header followed by the 8 KB pages of every column, each page at
+// a PAGE_SIZE aligned offset. Loading maps the file and points Column::pages
+// straight into the mapping: no copy, and pages are faulted in lazily on first use.
+// build_context maps the tables of SPC_TABLE_DIR (*.spct) into the context, which owns
+// the mappings; an InputBinding puts them into Plan::inputs for the duration of a run.
+//
+// layout:
+//   [FileHeader][ColumnEntry x num_columns] padded to a multiple of PAGE_SIZE
+//   [pages of column 0][pages of column 1]...
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <plan.h>
+#include <table.h>
+
+namespace tablefile{
+
+    constexpr char MAGIC[8] = {'S', 'P', 'C', 'T', 'A', 'B', 'L', 'E'};
+    constexpr uint32_t VERSION = 1;
+
+    struct FileHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t num_columns;
+        uint64_t num_rows;
+    };
+
+    struct ColumnEntry{
+        uint32_t type;        // DataType
+        uint32_t unused;
+        uint64_t first_page;  // page index inside the file
+        uint64_t num_pages;
+    };
+
+    inline size_t header_pages(size_t num_columns){
+        size_t bytes = sizeof(FileHeader) + num_columns * sizeof(ColumnEntry);
+        return (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    }
+
+    inline void write_all(int fd, const void* data, size_t bytes, const std::string& path){
+        const char* ptr = static_cast<const char*>(data);
+        while(bytes > 0){
+            ssize_t written = write(fd, ptr, bytes);
+            if(written < 0){
+                if(errno == EINTR) continue;
+                throw std::runtime_error("tablefile: write to " + path + " failed: " + std::strerror(errno));
+            }
+            ptr += written;
+            bytes -= static_cast<size_t>(written);
+        }
+    }
+
+    // Write a table once (e.g. right after loading it from its original source)
+    inline void write_table(const ColumnarTable& table, const std::string& path){
+        const size_t num_header_pages = header_pages(table.columns.size());
+        std::vector<std::byte> header(num_header_pages * PAGE_SIZE);
+
+        FileHeader file_header{};
+        memcpy(file_header.magic, MAGIC, sizeof(MAGIC));
+        file_header.version = VERSION;
+        file_header.num_columns = static_cast<uint32_t>(table.columns.size());
+        file_header.num_rows = table.num_rows;
+        memcpy(header.data(), &file_header, sizeof(FileHeader));
+
+        uint64_t next_page = num_header_pages;
+        for(size_t col_idx = 0; col_idx < table.columns.size(); ++col_idx){
+            const auto& column = table.columns[col_idx];
+            ColumnEntry entry{static_cast<uint32_t>(column.type), 0, next_page, column.pages.size()};
+            memcpy(header.data() + sizeof(FileHeader) + col_idx * sizeof(ColumnEntry), &entry, sizeof(ColumnEntry));
+            next_page += column.pages.size();
+        }
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) throw std::runtime_error("tablefile: cannot create " + path + ": " + std::strerror(errno));
+        try{
+            write_all(fd, header.data(), header.size(), path);
+            for(const auto& column : table.columns){
+                for(const auto* page : column.pages){
+                    write_all(fd, page->data, PAGE_SIZE, path);
+                }
+            }
+        } catch(...){
+            close(fd);
+            throw;
+        }
+        close(fd);
+    }
+
+    // Pages of a mapped table live in the mapping, not on the heap:
+    // clear them before a Column destructor tries to delete them.
+    inline void detach_pages(ColumnarTable& table){
+        for(auto& column : table.columns){
+            column.pages.clear();
+        }
+    }
+
+    struct MappedTable{
+        void* addr = nullptr;
+        size_t bytes = 0;
+        ColumnarTable table;
+
+        MappedTable() = default;
+        MappedTable(const MappedTable&) = delete;
+        MappedTable& operator=(const MappedTable&) = delete;
+
+        ~MappedTable(){
+            reset();
+        }
+
+        // Unmaps the file: the table is empty again
+        void reset(){
+            detach_pages(table);
+            table.columns.clear();
+            table.num_rows = 0;
+            if(addr) munmap(addr, bytes);
+            addr = nullptr;
+            bytes = 0;
+        }
+    };
+
+    // Mapped tables in the inputs of a plan for as long as the binding lives.
+    // Column deletes its pages, so a table pointing into a mapping must never be destroyed
+    // with them: the binding detaches the pages of every table it bound when it goes away.
+    // The mapped tables must outlive the binding, and the inputs must outlive it too.
+    class InputBinding{
+    public:
+        explicit InputBinding(std::vector<ColumnarTable>& inputs) : inputs(inputs) {}
+
+        ~InputBinding(){
+            for(size_t table_id : bound) detach_pages(inputs[table_id]);
+        }
+
+        InputBinding(const InputBinding&) = delete;
+        InputBinding& operator=(const InputBinding&) = delete;
+
+        // Input table_id (replaced, or appended when it is inputs.size()) reads the pages of mapped
+        void bind(size_t table_id, const MappedTable& mapped){
+            if(table_id > inputs.size()) throw std::out_of_range("tablefile: input table id out of range");
+
+            ColumnarTable view;
+            view.num_rows = mapped.table.num_rows;
+            view.columns.reserve(mapped.table.columns.size());
+            for(const auto& column : mapped.table.columns){
+                view.columns.emplace_back(column.type);
+                view.columns.back().pages = column.pages;
+            }
+
+            if(table_id == inputs.size()){
+                inputs.push_back(std::move(view));
+            }
+            else{
+                // the table replaced here may be a view bound before
+                if(std::find(bound.begin(), bound.end(), table_id) != bound.end()) detach_pages(inputs[table_id]);
+                inputs[table_id] = std::move(view);
+            }
+            if(std::find(bound.begin(), bound.end(), table_id) == bound.end()) bound.push_back(table_id);
+        }
+
+    private:
+        std::vector<ColumnarTable>& inputs;
+        std::vector<size_t> bound;
+    };
+
+    // populate = fault every page in up front instead of on first access.
+    // A table already loaded into mapped is unmapped first.
+    inline void load_table(const std::string& path, MappedTable& mapped, bool populate = false){
+        mapped.reset();
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw std::runtime_error("tablefile: cannot open " + path + ": " + std::strerror(errno));
+
+        struct stat st;
+        if(fstat(fd, &st) != 0){
+            close(fd);
+            throw std::runtime_error("tablefile: cannot stat " + path + ": " + std::strerror(errno));
+        }
+        const size_t bytes = static_cast<size_t>(st.st_size);
+        if(bytes < PAGE_SIZE || bytes % PAGE_SIZE != 0){
+            close(fd);
+            throw std::runtime_error("tablefile: " + path + " is not a table file (size)");
+        }
+
+        void* addr = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+        close(fd); // the mapping keeps the file alive
+        if(addr == MAP_FAILED){
+            throw std::runtime_error("tablefile: mmap of " + path + " failed: " + std::strerror(errno));
+        }
+        mapped.addr = addr;
+        mapped.bytes = bytes;
+
+        // a file that fails validation leaves mapped empty
+        try{
+            const auto* base = static_cast<const std::byte*>(addr);
+            FileHeader file_header;
+            memcpy(&file_header, base, sizeof(FileHeader));
+            if(memcmp(file_header.magic, MAGIC, sizeof(MAGIC)) != 0 || file_header.version != VERSION){
+                throw std::runtime_error("tablefile: " + path + " has a bad magic or version");
+            }
+
+            const size_t total_pages = bytes / PAGE_SIZE;
+            if(header_pages(file_header.num_columns) > total_pages){
+                throw std::runtime_error("tablefile: " + path + " is truncated (header)");
+            }
+
+            mapped.table.num_rows = file_header.num_rows;
+            mapped.table.columns.reserve(file_header.num_columns);
+            for(size_t col_idx = 0; col_idx < file_header.num_columns; ++col_idx){
+                ColumnEntry entry;
+                memcpy(&entry, base + sizeof(FileHeader) + col_idx * sizeof(ColumnEntry), sizeof(ColumnEntry));
+                if(entry.type > static_cast<uint32_t>(DataType::VARCHAR) ||
+                   entry.first_page > total_pages || entry.num_pages > total_pages - entry.first_page){
+                    throw std::runtime_error("tablefile: " + path + " has a corrupt column entry");
+                }
+
+                auto& column = mapped.table.columns.emplace_back(static_cast<DataType>(entry.type));
+                column.pages.reserve(entry.num_pages);
+                for(uint64_t page_idx = 0; page_idx < entry.num_pages; ++page_idx){
+                    // read-only mapping: execution never writes to input pages
+                    column.pages.push_back(reinterpret_cast<Page*>(const_cast<std::byte*>(base + (entry.first_page + page_idx) * PAGE_SIZE)));
+                }
+            }
+        } catch(...){
+            mapped.reset();
+            throw;
+        }
+    }
+
+} // namespace tablefile
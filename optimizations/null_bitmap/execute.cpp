@@ -0,0 +1,991 @@
+// Unchained hash version
+
+#include <hardware.h>
+#include <plan.h>
+#include <table.h>
+#include <iostream>
+
+#include <value_t.h>
+#include <column_t.h>
+#include <mycopyscan.h>
+#include <context.h>
+#include <execute_root.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <optional>
+
+#include <threaded_table.h>
+#include <unchained_table.h>
+#include <payload.h>
+#include <join_table.h>
+#include <spill.h>
+#include <index_file.h>
+#include <profile.h>
+#include <perf_counters.h>
+#include <skew.h>
+#include <morsel.h>
+#include <calibration.h>
+#include <estimate.h>
+#include <scatter.h>
+#include <validity.h>
+#include <filesystem>
+
+namespace Contest {
+
+using ExecuteResult = std::vector<columnt::column_t>;
+
+ExecuteResult execute_impl(const Plan& plan, size_t node_idx, ExecuteContext* context);
+
+struct JoinAlgorithm {
+    bool                                             build_left;
+    ExecuteResult&                                   left;
+    ExecuteResult&                                   right;
+    ExecuteResult&                                   results;
+    size_t                                           left_col, right_col;
+    const std::vector<std::tuple<size_t, DataType>>& output_attrs;
+    ExecuteContext*                                  context;
+    profile::JoinProfile*                            join_profile; // null when profiling is off
+    jointable::Engine                                engine = jointable::Engine::unchained;
+    std::vector<int32_t>                             payload_slots{}; // payload slot per output column, -1 = read the columns
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SPC_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define SPC_ALWAYS_INLINE inline
+#endif
+
+    SPC_ALWAYS_INLINE void emit_row(size_t left_idx, size_t right_idx) {
+        for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+            auto [col_idx, _] = output_attrs[out_idx];
+            if(col_idx < left.size()){
+                results[out_idx].push_back(left[col_idx][left_idx]);
+            }
+            else{
+                results[out_idx].push_back(right[col_idx - left.size()][right_idx]);
+            }
+        }
+    }
+
+    // Build-side outputs come from the entry payload, probe-side outputs from the probe columns
+    template <bool BuildLeft, typename Entry>
+    SPC_ALWAYS_INLINE void emit_payload_row(const Entry& entry, size_t probe_idx) {
+        const ExecuteResult& probe_side = BuildLeft ? right : left;
+        for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+            if(const int32_t slot = payload_slots[out_idx]; slot >= 0){
+                results[out_idx].push_back(entry.values[slot]);
+                continue;
+            }
+            const size_t col_idx = std::get<0>(output_attrs[out_idx]);
+            results[out_idx].push_back(probe_side[BuildLeft ? col_idx - left.size() : col_idx][probe_idx]);
+        }
+    }
+
+#undef SPC_ALWAYS_INLINE
+
+    template <bool BuildLeft, typename Table>
+    inline void probe_and_materialize(Table& table, const ExecuteResult& probe_side, size_t probe_col, size_t probe_threads){
+        using Entry = std::remove_cv_t<std::remove_pointer_t<decltype(table.find_range(int32_t{}, std::declval<size_t&>()))>>;
+        const size_t probe_rows = probe_side[probe_col].size();
+        morsel::Scheduler scheduler(probe_side[probe_col], probe_threads);
+        std::optional<profile::PhaseTimer> probe_timer(std::in_place, profile::phase(join_profile, &profile::JoinProfile::probe_ms));
+
+        const validity::Validity& valid = validity::of(probe_side[probe_col]);
+        const estimate::Estimate expected = estimate::sample(table, probe_side[probe_col]);
+        if(expected.valid()){
+            scheduler.expect(expected.fanout);
+            if(join_profile){
+                join_profile->estimated_rows = expected.rows;
+                join_profile->estimate_low = expected.low;
+                join_profile->estimate_high = expected.high;
+            }
+        }
+
+        if(probe_threads <= 1 || scheduler.pages() < 2 || probe_rows < join_thresholds(context).parallel_probe_rows){
+            perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::probe_counters));
+            if(expected.valid()){
+                const size_t pages = (expected.high + columnt::VALUES_PER_PAGE - 1) / columnt::VALUES_PER_PAGE;
+                for(auto& col : results){
+                    if(!col.ref) col.pages.reserve(pages);
+                }
+            }
+            uint64_t probes = 0, rejects = 0;
+            valid.for_each(0, probe_rows, [&](size_t probe_idx) {
+                const int32_t key = probe_side[probe_col][probe_idx].intvalue;
+
+                size_t len = 0;
+                const auto* entries = table.find_range(key, len);
+                ++probes;
+                rejects += !entries;
+                if(!entries || len == 0) return;
+
+                for(size_t i = 0; i < len; ++i){
+                    if(entries[i].key != key) continue;
+                    if constexpr (payload::has_payload<Entry>){
+                        emit_payload_row<BuildLeft>(entries[i], probe_idx);
+                        continue;
+                    }
+                    const size_t left_idx = BuildLeft ? entries[i].row_idx : probe_idx;
+                    const size_t right_idx = BuildLeft ? probe_idx : entries[i].row_idx;
+                    emit_row(left_idx, right_idx);
+                }
+            });
+            if(join_profile){
+                join_profile->bloom_probes += probes;
+                join_profile->bloom_rejects += rejects;
+            }
+            return;
+        }
+
+        // High fanout: count, then write every match at its output row, no match pairs buffered
+        if(expected.valid() && expected.fanout >= scatter::min_fanout()){
+            count_and_scatter<BuildLeft>(table, probe_side, probe_col, valid, probe_threads, expected.fanout, probe_timer);
+            return;
+        }
+
+        // Work stealing
+        // Each thread repeatedly claims the next morsel (a run of probe pages) from the scheduler,
+        // sized from the matches per probe row it measured so far.
+
+        std::vector<std::vector<std::pair<size_t, size_t>>> local_matches(probe_threads);
+        if(expected.valid()){
+            // a quarter over the even share of the upper bound, untouched capacity costs no memory
+            for(auto& matches : local_matches) matches.reserve(expected.high / probe_threads + expected.high / (4 * probe_threads));
+        }
+        std::vector<uint64_t> local_probes(probe_threads, 0), local_rejects(probe_threads, 0);
+
+        // match ranges too long for one thread, emitted by all threads after the pages
+        const size_t heavy_len = skew::heavy_range_entries();
+        std::vector<std::vector<skew::HeavyRange<Entry>>> local_heavy(probe_threads);
+
+        // payload tables record the entry instead of the build row, materialization reads its values
+        auto collect = [&](auto& matches, size_t probe_idx, int32_t key, const Entry* entries, size_t len) {
+            for(size_t i = 0; i < len; ++i){
+                if(entries[i].key != key) continue;
+                size_t build_idx = entries[i].row_idx;
+                if constexpr (payload::has_payload<Entry>) build_idx = static_cast<size_t>(entries + i - table.tuple_storage);
+                const size_t left_idx = BuildLeft ? build_idx : probe_idx;
+                const size_t right_idx = BuildLeft ? probe_idx : build_idx;
+                matches.emplace_back(left_idx, right_idx);
+            }
+        };
+
+        std::vector<std::thread> probe_workers;
+        probe_workers.reserve(probe_threads);
+
+        for(size_t t = 0; t < probe_threads; ++t){
+            probe_workers.emplace_back([&, t]() {
+                perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::probe_counters));
+                auto& matches = local_matches[t];
+                uint64_t probes = 0, rejects = 0;
+                uint64_t rows_done = 0, matches_done = 0;
+                size_t start = 0, end = 0;
+                while(scheduler.claim(scheduler.morsel_pages(rows_done, matches_done), start, end)){
+                    const size_t matches_before = matches.size();
+                    valid.for_each(start, end, [&](size_t probe_idx) {
+                        const int32_t key = probe_side[probe_col][probe_idx].intvalue;
+
+                        size_t len = 0;
+                        const auto* entries = table.find_range(key, len);
+                        ++probes;
+                        rejects += !entries;
+                        if(!entries || len == 0) return;
+
+                        if(len > heavy_len){
+                            local_heavy[t].push_back({probe_idx, key, entries, len});
+                            return;
+                        }
+                        collect(matches, probe_idx, key, entries, len);
+                    });
+                    rows_done += end - start;
+                    matches_done += matches.size() - matches_before;
+                }
+                local_probes[t] = probes;
+                local_rejects[t] = rejects;
+            });
+        }
+        for(auto& t : probe_workers) t.join();
+
+        skew::run_slices(skew::split(local_heavy, heavy_len), probe_threads,
+            profile::counters(join_profile, &profile::JoinProfile::probe_counters),
+            [&](size_t t, const skew::HeavyRange<Entry>& slice) {
+                collect(local_matches[t], slice.probe_idx, slice.key, slice.entries, slice.len);
+            });
+        probe_timer.reset();
+        if(join_profile){
+            for(size_t t = 0; t < probe_threads; ++t){
+                join_profile->bloom_probes += local_probes[t];
+                join_profile->bloom_rejects += local_rejects[t];
+            }
+        }
+
+        profile::PhaseTimer materialize_timer(profile::phase(join_profile, &profile::JoinProfile::materialize_ms));
+
+        // we compute the ranges for each thread
+        std::vector<size_t> offsets(probe_threads + 1, 0);
+        for(size_t t = 0; t < probe_threads; ++t){
+            offsets[t+1] = offsets[t] + local_matches[t].size();
+        }
+        const size_t total_rows = offsets[probe_threads];
+
+        allocate_results(total_rows);
+
+        // parallel materialization in disjoint output ranges
+        std::vector<std::thread> mat_workers;
+        mat_workers.reserve(probe_threads);
+        for(size_t t = 0; t < probe_threads; ++t){
+            mat_workers.emplace_back([&, t]() {
+                perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::materialize_counters));
+                const size_t base = offsets[t];
+                const auto& matches = local_matches[t];
+                for(size_t i = 0; i < matches.size(); ++i){
+                    const size_t out_row = base + i;
+                    const size_t left_idx = matches[i].first;
+                    const size_t right_idx = matches[i].second;
+
+                    for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+                        if constexpr (payload::has_payload<Entry>){
+                            if(const int32_t slot = payload_slots[out_idx]; slot >= 0){
+                                const auto& entry = table.tuple_storage[BuildLeft ? left_idx : right_idx];
+                                write_at(results[out_idx], out_row, entry.values[slot]);
+                                continue;
+                            }
+                        }
+                        auto [col_idx, _] = output_attrs[out_idx];
+                        if(col_idx < left.size()){
+                            write_at(results[out_idx], out_row, left[col_idx][left_idx]);
+                        } else {
+                            write_at(results[out_idx], out_row, right[col_idx - left.size()][right_idx]);
+                        }
+                    }
+                }
+            });
+        }
+        for(auto& th : mat_workers) th.join();
+    }
+
+    // pre-allocating columns to avoid locks
+    void allocate_results(size_t total_rows){
+        const size_t needed_pages = (total_rows + columnt::VALUES_PER_PAGE - 1) / columnt::VALUES_PER_PAGE;
+        for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+            auto& col = results[out_idx];
+            if(col.ref) continue;
+            col.pages.reserve(needed_pages);
+
+            while(col.pages.size() < needed_pages){
+                col.pages.push_back(columnt::new_intermediate_page());
+            }
+            col.num_values = total_rows;
+        }
+    }
+
+    // copies output rows per the moves, the columns split across threads
+    void move_results(const std::vector<scatter::Move>& moves, size_t threads){
+        auto move_column = [&](columnt::column_t& col) {
+            for(const auto& move : moves){
+                for(size_t i = 0; i < move.rows; ++i){
+                    const size_t from = move.from + i;
+                    write_at(col, move.to + i, col.pages[from / columnt::VALUES_PER_PAGE]->data[from % columnt::VALUES_PER_PAGE]);
+                }
+            }
+        };
+        std::atomic<size_t> next_column{0};
+        std::vector<std::thread> workers;
+        threads = std::min(threads, results.size());
+        workers.reserve(threads);
+        for(size_t t = 0; t < threads; ++t){
+            workers.emplace_back([&]() {
+                for(size_t out_idx = next_column.fetch_add(1, std::memory_order_relaxed); out_idx < results.size();
+                    out_idx = next_column.fetch_add(1, std::memory_order_relaxed)){
+                    if(!results[out_idx].ref) move_column(results[out_idx]);
+                }
+            });
+        }
+        for(auto& th : workers) th.join();
+    }
+
+    // cuts pre-allocated columns to total_rows, their pages past it go back to the pool
+    void shrink_results(size_t total_rows){
+        const size_t needed_pages = (total_rows + columnt::VALUES_PER_PAGE - 1) / columnt::VALUES_PER_PAGE;
+        for(auto& col : results){
+            if(col.ref) continue;
+            if(col.pages.size() > needed_pages){
+                pagepool::release(std::vector<columnt::Intermediate_Page*>(col.pages.begin() + needed_pages, col.pages.end()));
+                col.pages.resize(needed_pages);
+            }
+            col.num_values = total_rows;
+        }
+    }
+
+    static void write_at(columnt::column_t& col, size_t idx, const valuet::value_t& v){
+        const size_t page_idx = idx / columnt::VALUES_PER_PAGE;
+        const size_t offset = idx % columnt::VALUES_PER_PAGE;
+        col.pages[page_idx]->data[offset] = v;
+    }
+
+    // see scatter.h
+    template <bool BuildLeft, typename Table>
+    void count_and_scatter(const Table& table, const ExecuteResult& probe_side, size_t probe_col, const validity::Validity& valid,
+                           size_t probe_threads, double fanout, std::optional<profile::PhaseTimer>& probe_timer){
+        using Entry = std::remove_cv_t<std::remove_pointer_t<decltype(table.find_range(int32_t{}, std::declval<size_t&>()))>>;
+        const auto& keys = probe_side[probe_col];
+        morsel::Scheduler scheduler(keys, probe_threads);
+        scheduler.expect(fanout);
+        const size_t heavy_len = skew::heavy_range_entries();
+        if(join_profile) join_profile->scatter = true;
+
+        // Pass 1: candidate range lengths per morsel, heavy ranges recorded
+        std::vector<std::vector<scatter::Morsel>> local_morsels(probe_threads);
+        std::vector<std::vector<skew::HeavyRange<Entry>>> local_heavy(probe_threads);
+        std::vector<uint64_t> local_probes(probe_threads, 0), local_rejects(probe_threads, 0);
+        std::vector<std::thread> count_workers;
+        count_workers.reserve(probe_threads);
+        for(size_t t = 0; t < probe_threads; ++t){
+            count_workers.emplace_back([&, t]() {
+                perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::probe_counters));
+                uint64_t probes = 0, rejects = 0;
+                uint64_t rows_done = 0, matches_done = 0;
+                size_t start = 0, end = 0;
+                while(scheduler.claim(scheduler.morsel_pages(rows_done, matches_done), start, end)){
+                    size_t bound = 0;
+                    valid.for_each(start, end, [&](size_t probe_idx) {
+                        const int32_t key = keys[probe_idx].intvalue;
+
+                        size_t len = 0;
+                        const auto* entries = table.find_range(key, len);
+                        ++probes;
+                        rejects += !entries;
+                        if(!entries || len == 0) return;
+
+                        if(len > heavy_len){
+                            local_heavy[t].push_back({probe_idx, key, entries, len});
+                            return;
+                        }
+                        bound += len;
+                    });
+                    local_morsels[t].push_back({start, end, {0, bound, 0}});
+                    rows_done += end - start;
+                    matches_done += bound;
+                }
+                local_probes[t] = probes;
+                local_rejects[t] = rejects;
+            });
+        }
+        for(auto& t : count_workers) t.join();
+        probe_timer.reset();
+        if(join_profile){
+            for(size_t t = 0; t < probe_threads; ++t){
+                join_profile->bloom_probes += local_probes[t];
+                join_profile->bloom_rejects += local_rejects[t];
+            }
+        }
+
+        profile::PhaseTimer materialize_timer(profile::phase(join_profile, &profile::JoinProfile::materialize_ms));
+
+        // output region of every morsel (in probe row order), then of every heavy slice
+        std::vector<scatter::Morsel> morsels;
+        for(const auto& claimed : local_morsels) morsels.insert(morsels.end(), claimed.begin(), claimed.end());
+        std::sort(morsels.begin(), morsels.end(), [](const scatter::Morsel& a, const scatter::Morsel& b) { return a.begin < b.begin; });
+        const auto slices = skew::split(local_heavy, heavy_len);
+        std::vector<scatter::Region> slice_rows(slices.size());
+        size_t bound_rows = 0;
+        for(auto& m : morsels){
+            m.rows.out = bound_rows;
+            bound_rows += m.rows.bound;
+        }
+        for(size_t i = 0; i < slices.size(); ++i){
+            slice_rows[i] = {bound_rows, slices[i].len, 0};
+            bound_rows += slices[i].len;
+        }
+
+        allocate_results(bound_rows);
+
+        // payload tables record the entry instead of the build row, the writes read its values
+        auto collect = [&](auto& chunk, size_t probe_idx, int32_t key, const Entry* entries, size_t len) {
+            for(size_t i = 0; i < len; ++i){
+                if(entries[i].key != key) continue;
+                size_t build_idx = entries[i].row_idx;
+                if constexpr (payload::has_payload<Entry>) build_idx = static_cast<size_t>(entries + i - table.tuple_storage);
+                chunk.emplace_back(BuildLeft ? build_idx : probe_idx, BuildLeft ? probe_idx : build_idx);
+            }
+        };
+
+        // writes the collected matches from out_row on, one output column at a time, returns the next output row
+        auto write_chunk = [&](std::vector<std::pair<size_t, size_t>>& chunk, size_t out_row) {
+            for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+                auto& col = results[out_idx];
+                size_t row = out_row;
+                if constexpr (payload::has_payload<Entry>){
+                    if(const int32_t slot = payload_slots[out_idx]; slot >= 0){
+                        for(const auto& [left_idx, right_idx] : chunk){
+                            write_at(col, row++, table.tuple_storage[BuildLeft ? left_idx : right_idx].values[slot]);
+                        }
+                        continue;
+                    }
+                }
+                const size_t col_idx = std::get<0>(output_attrs[out_idx]);
+                if(col_idx < left.size()){
+                    const auto& source = left[col_idx];
+                    for(const auto& match : chunk) write_at(col, row++, source[match.first]);
+                } else {
+                    const auto& source = right[col_idx - left.size()];
+                    for(const auto& match : chunk) write_at(col, row++, source[match.second]);
+                }
+            }
+            out_row += chunk.size();
+            chunk.clear();
+            return out_row;
+        };
+
+        // Pass 2: probe every morsel again, its matches go to its output region a chunk at a time:
+        // a few thousand buffered matches stay in cache and every column is written in a run
+        constexpr size_t CHUNK_MATCHES = 1024;
+        std::atomic<size_t> next_morsel{0};
+        std::vector<std::thread> scatter_workers;
+        scatter_workers.reserve(probe_threads);
+        for(size_t t = 0; t < probe_threads; ++t){
+            scatter_workers.emplace_back([&]() {
+                perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::materialize_counters));
+                std::vector<std::pair<size_t, size_t>> chunk;
+                chunk.reserve(CHUNK_MATCHES);
+                for(size_t m = next_morsel.fetch_add(1, std::memory_order_relaxed); m < morsels.size();
+                    m = next_morsel.fetch_add(1, std::memory_order_relaxed)){
+                    size_t out_row = morsels[m].rows.out;
+                    valid.for_each(morsels[m].begin, morsels[m].end, [&](size_t probe_idx) {
+                        const int32_t key = keys[probe_idx].intvalue;
+
+                        size_t len = 0;
+                        const auto* entries = table.find_range(key, len);
+                        if(!entries || len == 0 || len > heavy_len) return;
+                        collect(chunk, probe_idx, key, entries, len);
+                        if(chunk.size() >= CHUNK_MATCHES) out_row = write_chunk(chunk, out_row);
+                    });
+                    out_row = write_chunk(chunk, out_row);
+                    morsels[m].rows.written = out_row - morsels[m].rows.out;
+                }
+            });
+        }
+        for(auto& th : scatter_workers) th.join();
+
+        // a slice holds at most heavy_len matches
+        std::vector<std::vector<std::pair<size_t, size_t>>> slice_chunks(probe_threads);
+        skew::run_slices(slices, probe_threads, profile::counters(join_profile, &profile::JoinProfile::materialize_counters),
+            [&](size_t t, const skew::HeavyRange<Entry>& slice) {
+                scatter::Region& rows = slice_rows[static_cast<size_t>(&slice - slices.data())];
+                collect(slice_chunks[t], slice.probe_idx, slice.key, slice.entries, slice.len);
+                rows.written = write_chunk(slice_chunks[t], rows.out) - rows.out;
+            });
+
+        // close the gaps the bounds left and cut the output to the matches
+        std::vector<scatter::Region> regions;
+        regions.reserve(morsels.size() + slice_rows.size());
+        size_t total_rows = 0;
+        for(const auto& m : morsels) regions.push_back(m.rows);
+        regions.insert(regions.end(), slice_rows.begin(), slice_rows.end());
+        for(const auto& rows : regions) total_rows += rows.written;
+        if(total_rows < bound_rows){
+            move_results(scatter::fill_gaps(regions, total_rows), probe_threads);
+            shrink_results(total_rows);
+        }
+    }
+
+    void record_path(const char* path, size_t threads, bool build_is_left){
+        if(!join_profile) return;
+        join_profile->path = path;
+        join_profile->threads = threads;
+        join_profile->build_left = build_is_left;
+        join_profile->build_rows = build_is_left ? left[left_col].size() : right[right_col].size();
+        join_profile->probe_rows = build_is_left ? right[right_col].size() : left[left_col].size();
+    }
+
+    auto run() {
+        size_t build_size = build_left ? left[left_col].size() : right[right_col].size();
+
+        const calibration::Thresholds& limits = join_thresholds(context);
+        size_t num_threads = limits.threads;
+        if(build_size < limits.single_thread_build) num_threads = 1;
+
+        const bool use_threaded = build_size >= limits.threaded_min_build;
+
+        size_t num_partitions = 1;
+        while(num_partitions < num_threads) num_partitions *= 2;
+        num_threads = num_partitions;
+
+        // Prebuilt index over a key column: nothing to build, probe the other side against it
+        if(context){
+            const auto* left_index = indexfile::find_index(context->indexes, context->identities, left[left_col]);
+            const auto* right_index = left_index ? nullptr : indexfile::find_index(context->indexes, context->identities, right[right_col]);
+            if(left_index || right_index){
+                size_t probe_threads = limits.threads;
+
+                record_path("index", probe_threads, left_index != nullptr);
+                if(left_index){
+                    probe_and_materialize<true>(*left_index, right, right_col, probe_threads);
+                } else {
+                    probe_and_materialize<false>(*right_index, left, left_col, probe_threads);
+                }
+                return;
+            }
+        }
+
+        // Out-of-core: the build does not fit the memory budget => grace join through spill files
+        if(const size_t budget = spill::memory_budget_bytes(); budget && spill::build_footprint(build_size) > budget){
+            record_path("grace", 1, build_left);
+            profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::probe_ms));
+            const ExecuteResult& build_side = build_left ? left : right;
+            const ExecuteResult& probe_side = build_left ? right : left;
+            spill::grace_join(build_side[build_left ? left_col : right_col], probe_side[build_left ? right_col : left_col], budget,
+                [&](size_t build_idx, size_t probe_idx){
+                    emit_row(build_left ? build_idx : probe_idx, build_left ? probe_idx : build_idx);
+                });
+            return;
+        }
+
+        // Another engine chosen for this join (SPC_JOIN_ENGINE): builds of any size go through it
+        if(engine != jointable::Engine::unchained){
+            const ExecuteResult& build_side = build_left ? left : right;
+            const size_t build_key_col = build_left ? left_col : right_col;
+            const ExecuteResult& probe_side = build_left ? right : left;
+            const size_t probe_key_col = build_left ? right_col : left_col;
+
+            size_t probe_threads = 1;
+            while (probe_threads < limits.threads) probe_threads *= 2;
+            record_path(jointable::name(engine), probe_threads, build_left);
+
+            jointable::with_table(engine, [&](auto& table) {
+                {
+                    profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                    jointable::build(table, build_side[build_key_col], validity::of(build_side[build_key_col]), build_size, num_threads);
+                }
+                if (build_left) {
+                    probe_and_materialize<true>(table, probe_side, probe_key_col, probe_threads);
+                } else {
+                    probe_and_materialize<false>(table, probe_side, probe_key_col, probe_threads);
+                }
+            });
+            return;
+        }
+
+        // Unthreaded building
+        if(!use_threaded){
+            const ExecuteResult& build_side = build_left ? left : right;
+            const size_t build_key_col = build_left ? left_col : right_col;
+            const ExecuteResult& probe_side = build_left ? right : left;
+            const size_t probe_key_col = build_left ? right_col : left_col;
+
+            size_t probe_threads = limits.threads;
+            size_t probe_partitions = 1;
+            while (probe_partitions < probe_threads) probe_partitions *= 2;
+            probe_threads = probe_partitions;
+
+            const validity::Validity& build_valid = validity::of(build_side[build_key_col]);
+
+            // small build side with few output columns: the entries carry the build-side outputs
+            payload::Layout layout = payload::layout(output_attrs, left.size(), build_left);
+            if(payload::enabled(layout, build_size)){
+                payload_slots = std::move(layout.slot_of_output);
+                payload::with_width(layout.build_columns.size(), [&](auto width) {
+                    payload::Table<decltype(width)::value> payload_table;
+                    {
+                        profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                        payload::build(payload_table, build_side, build_key_col, build_valid, layout.build_columns, build_size, num_threads);
+                    }
+                    record_path("unchained_payload", probe_threads, build_left);
+                    if (build_left) {
+                        probe_and_materialize<true>(payload_table, probe_side, probe_key_col, probe_threads);
+                    } else {
+                        probe_and_materialize<false>(payload_table, probe_side, probe_key_col, probe_threads);
+                    }
+                });
+                return;
+            }
+
+            ::UnchainedHashTable hash_table;
+            hash_table.reserve(build_size);
+
+            // mid-sized builds: count, prefix sum and scatter in parallel, straight from the key column
+            const bool parallel_build = num_threads > 1;
+            if(parallel_build){
+                profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                validity::dispatch(build_valid, [&](auto all_valid) {
+                    hash_table.build_parallel(build_size, num_threads, [&](size_t row_idx, ::HashEntry& entry){
+                        if constexpr (!decltype(all_valid)::value){
+                            if(!build_valid.test(row_idx)) return false;
+                        }
+                        entry = ::HashEntry(build_side[build_key_col][row_idx].intvalue, row_idx);
+                        return true;
+                    });
+                });
+            }
+            else{
+                {
+                    profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::collect_ms));
+                    build_valid.for_each(0, build_size, [&](size_t row_idx) {
+                        hash_table.insert(build_side[build_key_col][row_idx].intvalue, row_idx);
+                    });
+                }
+                profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                hash_table.finalize();
+            }
+
+            // Probing
+            record_path(parallel_build ? "unchained_parallel" : "unthreaded", probe_threads, build_left);
+
+            if (build_left) {
+                probe_and_materialize<true>(hash_table, probe_side, probe_key_col, probe_threads);
+            } else {
+                probe_and_materialize<false>(hash_table, probe_side, probe_key_col, probe_threads);
+            }
+            return;
+        }
+
+        // threaded building
+        const ExecuteResult& build_side = build_left ? left : right;
+        const size_t build_key_col = build_left ? left_col : right_col;
+        const ExecuteResult& probe_side = build_left ? right : left;
+        const size_t probe_key_col = build_left ? right_col : left_col;
+
+        record_path("threaded", num_threads, build_left);
+        std::optional<profile::PhaseTimer> phase_timer(std::in_place, profile::phase(join_profile, &profile::JoinProfile::collect_ms));
+        const validity::Validity& build_valid = validity::of(build_side[build_key_col]);
+
+        // Phase 1: Collect
+        threaded::GlobalAllocator globalAlloc;
+        std::vector<std::unique_ptr<threaded::TupleCollector>> collectors;
+        collectors.reserve(num_threads);
+        for(size_t i=0; i<num_threads; ++i){
+            collectors.push_back(std::make_unique<threaded::TupleCollector>(globalAlloc, num_partitions));
+        }
+
+        if(num_threads == 1){
+            perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::collect_counters));
+            auto& collector = *collectors[0];
+            build_valid.for_each(0, build_size, [&](size_t row_idx) {
+                collector.consume(threaded::HashEntry(build_side[build_key_col][row_idx].intvalue, row_idx));
+            });
+        }
+        else{
+            std::vector<std::thread> threads;
+            size_t rows_per_thread = (build_size + num_threads - 1) / num_threads;
+
+            for(size_t t = 0; t < num_threads; ++t){
+                threads.emplace_back([&, t](){
+                    perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::collect_counters));
+                    size_t start = t * rows_per_thread;
+                    size_t end = std::min(start + rows_per_thread, build_size);
+                    auto& collector = *collectors[t];
+
+                    build_valid.for_each(start, end, [&](size_t row_idx) {
+                        collector.consume(threaded::HashEntry(build_side[build_key_col][row_idx].intvalue, row_idx));
+                    });
+                });
+            }
+            for(auto& t : threads) t.join();
+        }
+
+        // Merge
+        phase_timer.emplace(profile::phase(join_profile, &profile::JoinProfile::merge_ms));
+        std::vector<threaded::Block*> partition_heads = threaded::merge_partitions(collectors, num_partitions);
+
+        // Phase 2: Count and Copy
+        size_t total_tuples = 0;
+        for(const auto& col : collectors){
+            for(size_t c : col->counts) total_tuples += c;
+        }
+
+        phase_timer.emplace(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+        threaded::FinalTable final_table(total_tuples, num_partitions);
+
+        std::vector<size_t> partition_offsets(num_partitions, 0);
+        size_t running_count = 0;
+
+        std::vector<size_t> global_partition_counts(num_partitions, 0);
+        for(size_t p=0; p<num_partitions; ++p){
+            for(const auto& col : collectors) {
+                global_partition_counts[p] += col->counts[p];
+            }
+        }
+
+        for(size_t p=0; p<num_partitions; ++p) {
+            partition_offsets[p] = running_count;
+            running_count += global_partition_counts[p];
+        }
+
+        if (num_partitions == 1) {
+            perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::build_counters));
+            final_table.postProcessBuild(0, static_cast<uint64_t>(partition_offsets[0]), partition_heads);
+        } else {
+            std::vector<std::thread> build_threads;
+            build_threads.reserve(num_partitions);
+            for (size_t p = 0; p < num_partitions; ++p) {
+                build_threads.emplace_back([&, p]() {
+                    perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::build_counters));
+                    final_table.postProcessBuild(
+                        static_cast<uint64_t>(p),
+                        static_cast<uint64_t>(partition_offsets[p]),
+                        partition_heads);
+                });
+            }
+            for (auto& t : build_threads) t.join();
+        }
+        phase_timer.reset();
+
+        // Probing
+        if (build_left) {
+            probe_and_materialize<true>(final_table, probe_side, probe_key_col, num_threads);
+        } else {
+            probe_and_materialize<false>(final_table, probe_side, probe_key_col, num_threads);
+        }
+    }
+};
+
+ExecuteResult execute_hash_join(const Plan&          plan,
+    size_t                                           node_idx,
+    const JoinNode&                                  join,
+    const std::vector<std::tuple<size_t, DataType>>& output_attrs,
+    ExecuteContext*                                  context) {
+    auto                           left_idx    = join.left;
+    auto                           right_idx   = join.right;
+    auto&                          left_node   = plan.nodes[left_idx];
+    auto&                          right_node  = plan.nodes[right_idx];
+    auto&                          left_types  = left_node.output_attrs;
+    auto&                          right_types = right_node.output_attrs;
+    auto                           left        = execute_impl(plan, left_idx, context);
+    auto                           right       = execute_impl(plan, right_idx, context);
+    ExecuteResult results(output_attrs.size());
+
+    // Compute build_left based on actual cardinalities (paper recommendation)
+    bool build_left = left[join.left_attr].size() <= right[join.right_attr].size();
+
+    // children are done: their entries come before this one
+    profile::JoinProfile* join_profile = nullptr;
+    if(context && context->profiling){
+        join_profile = &context->profile.add_join();
+        join_profile->node_idx = node_idx;
+        join_profile->left_node = left_idx;
+        join_profile->right_node = right_idx;
+    }
+
+    JoinAlgorithm join_algorithm{.build_left = build_left,
+        .left                                = left,
+        .right                               = right,
+        .results                             = results,
+        .left_col                            = join.left_attr,
+        .right_col                           = join.right_attr,
+        .output_attrs                        = output_attrs,
+        .context                             = context,
+        .join_profile                        = join_profile,
+        .engine                              = context ? context->engines.for_node(node_idx) : jointable::Engine::unchained};
+
+    // key columns of a scan share the bitmap of their input column
+    if(context){
+        context->validities.attach(left[join.left_attr]);
+        context->validities.attach(right[join.right_attr]);
+    }
+
+    {
+        profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::total_ms));
+        join_algorithm.run();
+    }
+
+    // only matching keys get out of a join: copies of its key columns (or of null-free columns) have no NULL rows
+    for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx){
+        const size_t col_idx = std::get<0>(output_attrs[out_idx]);
+        const bool left_col = col_idx < left.size();
+        const size_t side_idx = left_col ? col_idx : col_idx - left.size();
+        const auto& source = (left_col ? left[side_idx] : right[side_idx]).valid_rows;
+        if(side_idx == (left_col ? join.left_attr : join.right_attr) || (source && source->all_valid)){
+            results[out_idx].valid_rows = validity::all_rows_valid();
+        }
+    }
+
+    if(join_profile){
+        join_profile->output_rows = results.empty() ? 0 : results[0].size();
+        for(const auto& col : results){
+            if(!col.ref) join_profile->pages_allocated += col.pages.size();
+        }
+    }
+    return results;
+}
+
+ExecuteResult execute_scan(const Plan&               plan,
+    const ScanNode&                                  scan,
+    const std::vector<std::tuple<size_t, DataType>>& output_attrs) {
+    auto                           table_id = scan.base_table_id;
+    auto&                          input    = plan.inputs[table_id];
+    return mycopyscan::copy_scan_value_t(input, output_attrs, static_cast<uint8_t>(table_id));
+}
+
+ExecuteResult execute_impl(const Plan& plan, size_t node_idx, ExecuteContext* context) {
+    auto& node = plan.nodes[node_idx];
+    return std::visit(
+        [&](const auto& value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, JoinNode>) {
+                return execute_hash_join(plan, node_idx, value, node.output_attrs, context);
+            } else {
+                return execute_scan(plan, value, node.output_attrs);
+            }
+        },
+        node.data);
+}
+
+ColumnarTable execute(const Plan& plan, [[maybe_unused]] void* context) {
+    auto* ctx = static_cast<ExecuteContext*>(context);
+    if(ctx && ctx->profiling){
+        ctx->profile.reset(ctx->queries);
+    }
+    if(ctx){
+        ctx->queries++;
+        ctx->identities.begin_query();
+        ctx->validities.begin_query();
+    }
+
+    std::optional<profile::PhaseTimer> query_timer;
+    if(ctx && ctx->profiling) query_timer.emplace(&ctx->profile.total_ms);
+    auto result = execute_impl_root(plan, plan.root, ctx);
+    if(query_timer){
+        query_timer.reset();
+        profile::dump(ctx->profile, ctx->profile_target);
+    }
+
+    // every intermediate page is back in the pool: give up the slabs above the budget
+    if(ctx && ctx->page_pool.over_budget()){
+        pagepool::local_cache.flush();
+        ctx->page_pool.trim();
+    }
+    return result;
+}
+
+// Wall time (ms) of one synthetic join under forced thresholds:
+// unique build keys, probe keys drawn from twice the build key range
+double time_synthetic_join(ExecuteContext* ctx, const calibration::Thresholds& forced, size_t build_rows, size_t probe_rows) {
+    ExecuteResult build(1), probe(1);
+    for(size_t row = 0; row < build_rows; ++row){
+        build[0].push_back(valuet::value_t(static_cast<int32_t>(row)));
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ probe_rows;
+    for(size_t row = 0; row < probe_rows; ++row){
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        probe[0].push_back(valuet::value_t(static_cast<int32_t>((state >> 33) % std::max<size_t>(1, 2 * build_rows))));
+    }
+    const std::vector<std::tuple<size_t, DataType>> output_attrs{{0, DataType::INT32}, {1, DataType::INT32}};
+
+    const calibration::Thresholds saved = ctx->thresholds;
+    ctx->thresholds = forced;
+    ExecuteResult results(output_attrs.size());
+    JoinAlgorithm join_algorithm{.build_left = true,
+        .left                                = build,
+        .right                               = probe,
+        .results                             = results,
+        .left_col                            = 0,
+        .right_col                           = 0,
+        .output_attrs                        = output_attrs,
+        .context                             = ctx,
+        .join_profile                        = nullptr};
+    auto begin = std::chrono::steady_clock::now();
+    join_algorithm.run();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    ctx->thresholds = saved;
+    return ms;
+}
+
+void* build_context() {
+    size_t page_pool_mb = 512; // retained intermediate pages between queries
+    if(const char* v = std::getenv("SPC_PAGE_POOL_MB")){
+        const size_t parsed = parse_env_threads(v);
+        if(parsed > 0) page_pool_mb = parsed;
+    }
+
+    auto* ctx = new ExecuteContext(page_pool_mb << 20);
+    pagepool::activate(&ctx->page_pool);
+
+    if(const char* target = std::getenv("SPC_PROFILE"); target && *target){
+        ctx->profiling = true;
+        ctx->profile_target = target;
+    }
+    // hardware counters come with the profile unless SPC_PROFILE_COUNTERS=0
+    if(const char* v = std::getenv("SPC_PROFILE_COUNTERS"); v && std::strcmp(v, "0") == 0){
+        perfcounters::disabled = true;
+    }
+
+    // SPC_CALIBRATE=1 measures the parallelism thresholds of this host once and caches them
+    // in SPC_CALIBRATION_FILE, SPC_CALIBRATE=force measures again
+    if(const char* mode = std::getenv("SPC_CALIBRATE"); mode && *mode && std::strcmp(mode, "0") != 0){
+        const char* file = std::getenv("SPC_CALIBRATION_FILE");
+        const std::string path = file && *file ? file : "spc_calibration.txt";
+        const size_t threads = std::min(ctx->thresholds.threads, calibration::available_cpus());
+        const std::string key = calibration::host_key(threads);
+        if(std::strcmp(mode, "force") == 0 || !calibration::load(path, key, ctx->thresholds)){
+            ctx->thresholds = calibration::calibrate(threads, [&](const calibration::Thresholds& forced, size_t build_rows, size_t probe_rows) {
+                return time_synthetic_join(ctx, forced, build_rows, probe_rows);
+            });
+            calibration::save(path, key, ctx->thresholds);
+            std::cerr << "calibration: " << calibration::describe(ctx->thresholds) << std::endl;
+        }
+    }
+    ctx->thresholds = calibration::with_env_overrides(ctx->thresholds);
+
+    if(const char* engines = std::getenv("SPC_JOIN_ENGINE"); engines && *engines){
+        ctx->engines = jointable::parse_selection(engines);
+    }
+
+    // input tables in the native format (*.spct), mapped until the context is destroyed;
+    // tablefile::InputBinding puts them into the inputs of a plan
+    if(const char* dir = std::getenv("SPC_TABLE_DIR"); dir && *dir){
+        std::error_code ec;
+        for(const auto& file : std::filesystem::directory_iterator(dir, ec)){
+            if(file.path().extension() != ".spct") continue;
+            auto mapped = std::make_unique<tablefile::MappedTable>();
+            try{
+                tablefile::load_table(file.path().string(), *mapped);
+                ctx->tables[file.path().stem().string()] = std::move(mapped);
+            } catch(const std::exception& e){
+                std::cerr << "skipping table " << file.path() << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    // prebuilt hash indexes (*.spci), checked against the key column identity before use
+    if(const char* dir = std::getenv("SPC_INDEX_DIR"); dir && *dir){
+        std::error_code ec;
+        for(const auto& file : std::filesystem::directory_iterator(dir, ec)){
+            if(file.path().extension() != ".spci") continue;
+            try{
+                ctx->indexes.push_back(indexfile::load_index(file.path().string()));
+            } catch(const std::exception& e){
+                std::cerr << "skipping index " << file.path() << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    // columns of the mapped tables are fingerprinted once, for the lifetime of the context,
+    // and keep their NULL bitmaps once a join computed them
+    for(const auto& [name, mapped] : ctx->tables){
+        for(const auto& column : mapped->table.columns){
+            if(column.type != DataType::INT32 || column.pages.empty()) continue;
+            ctx->validities.keep(column);
+            if(indexfile::may_match(ctx->indexes, column, mapped->table.num_rows)){
+                ctx->identities.get(column, mapped->table.num_rows, true);
+            }
+        }
+    }
+    return ctx;
+}
+
+void destroy_context([[maybe_unused]] void* context) {
+    auto* ctx = static_cast<ExecuteContext*>(context);
+    pagepool::deactivate();
+    delete ctx;
+}
+
+} // namespace Contest
\ No newline at end of file
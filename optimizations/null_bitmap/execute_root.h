@@ -0,0 +1,971 @@
+#pragma once
+#include <hardware.h>
+#include <plan.h>
+#include <table.h>
+#include <value_t.h>
+#include <column_t.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <threaded_table.h>
+#include <unchained_table.h>
+#include <payload.h>
+#include <join_table.h>
+#include <spill.h>
+#include <index_file.h>
+#include <context.h>
+#include <profile.h>
+#include <perf_counters.h>
+#include <skew.h>
+#include <morsel.h>
+#include <calibration.h>
+#include <estimate.h>
+#include <validity.h>
+
+namespace Contest {
+    using ExecuteResult = std::vector<columnt::column_t>;
+    ExecuteResult execute_impl(const Plan& plan, size_t node_idx, ExecuteContext* context);
+
+    namespace {
+
+    inline size_t parse_env_threads(const char* s) {
+        if (!s || !*s) return 0;
+        char* end = nullptr;
+        unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s) return 0;
+        return static_cast<size_t>(v);
+    }
+    
+    // Calibrated (or default) parallelism thresholds with the SPC_* overrides applied
+    inline const calibration::Thresholds& join_thresholds(const ExecuteContext* context) {
+        static const calibration::Thresholds defaults = calibration::with_env_overrides(calibration::Thresholds{});
+        return context ? context->thresholds : defaults;
+    }
+
+    } // namespace
+
+    struct JoinAlgorithmColumnar{
+        bool                                             build_left;
+        ExecuteResult&                                   left;
+        ExecuteResult&                                   right;
+        ColumnarTable&                                   results;
+        size_t                                           left_col, right_col;
+        const std::vector<std::tuple<size_t, DataType>>& output_attrs;
+        const Plan&                                      plan;
+        ExecuteContext*                                  context;
+        profile::JoinProfile*                            join_profile; // null when profiling is off
+        jointable::Engine                                engine = jointable::Engine::unchained;
+
+        // Persistent buffer state for each output column
+        struct IntColumnBuffer{
+            uint16_t num_rows = 0;
+            std::vector<int32_t> data;
+            std::vector<uint8_t> bitmap;
+
+            IntColumnBuffer(){
+                data.reserve(2048);
+                bitmap.reserve(256);
+            }
+
+            void save_page(Column& column){
+                auto* page                             = column.new_page()->data;
+                *reinterpret_cast<uint16_t*>(page)     = num_rows;
+                *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(data.size());
+                memcpy(page + 4, data.data(), data.size() * 4);
+                memcpy(page + PAGE_SIZE - bitmap.size(), bitmap.data(), bitmap.size());
+                num_rows = 0;
+                data.clear();
+                bitmap.clear();
+            }
+        };
+
+        struct VarcharColumnBuffer{
+            uint16_t num_rows = 0;
+            std::vector<char> data;
+            std::vector<uint16_t> offsets;
+            std::vector<uint8_t> bitmap;
+
+            VarcharColumnBuffer(){
+                data.reserve(8192);
+                offsets.reserve(4096);
+                bitmap.reserve(512);
+            }
+
+            void save_page(Column& column){
+                auto* page                             = column.new_page()->data;
+                *reinterpret_cast<uint16_t*>(page)     = num_rows;
+                *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(offsets.size());
+                memcpy(page + 4, offsets.data(), offsets.size() * 2);
+                memcpy(page + 4 + offsets.size() * 2, data.data(), data.size());
+                memcpy(page + PAGE_SIZE - bitmap.size(), bitmap.data(), bitmap.size());
+                num_rows = 0;
+                data.clear();
+                offsets.clear();
+                bitmap.clear();
+            };
+        };
+
+        std::vector<IntColumnBuffer> int_buffers;
+        std::vector<VarcharColumnBuffer> varchar_buffers;
+
+        std::vector<int32_t> out_to_int_idx;
+        std::vector<int32_t> out_to_varchar_idx;
+        std::vector<int32_t> payload_slots; // payload slot per output column, -1 = read the columns
+
+        std::string materialize_string(const Plan& plan, const valuet::NewString& stringref){
+            uint8_t table_id = stringref.table_id;
+            uint8_t column_id = stringref.column_id;
+            uint32_t page_id = stringref.page_id;
+            uint16_t offset_idx = stringref.offset_idx;
+
+            const auto& column = plan.inputs[table_id].columns[column_id];
+            auto* page = column.pages[page_id]->data;
+
+            uint16_t num_rows = *reinterpret_cast<const uint16_t*>(page);
+            const uint16_t num_values = *reinterpret_cast<const uint16_t*>(page + 2);
+            const auto* offsets = reinterpret_cast<const uint16_t*>(page + 4);
+            const auto* data_base = reinterpret_cast<const char*>(page + 4 + num_values * 2);
+
+            if(num_rows != 0xffff && num_rows != 0xfffe){
+                uint16_t start = (offset_idx == 0) ? 0 : offsets[offset_idx - 1];
+                uint16_t length = offsets[offset_idx] - start;
+                return std::string(data_base + start, length);
+            }
+            
+            // long string materialization
+            std::string result;
+            uint32_t current_page_id = page_id;
+
+            // Process first page (0xffff)
+            page = column.pages[current_page_id]->data;
+            uint16_t length = *reinterpret_cast<const uint16_t*>(page + 2);
+            const char* start = reinterpret_cast<const char*>(page + 4);
+            result.append(start, length);
+            current_page_id++;
+
+            // Process continuation pages (0xfffe) until we hit something else
+            while(current_page_id < column.pages.size()){
+                page = column.pages[current_page_id]->data;
+                num_rows = *reinterpret_cast<const uint16_t*>(page);
+                
+                if (num_rows != 0xfffe) break;  // Stop if not a continuation page
+                
+                length = *reinterpret_cast<const uint16_t*>(page + 2);
+                start = reinterpret_cast<const char*>(page + 4);
+                result.append(start, length);
+                current_page_id++;
+            }
+            return result;
+        }
+
+        void set_bitmap(std::vector<uint8_t>& bitmap, uint16_t idx) {
+            while (bitmap.size() < idx / 8 + 1) {
+                bitmap.emplace_back(0);
+            }
+            auto byte_idx     = idx / 8;
+            auto bit          = idx % 8;
+            bitmap[byte_idx] |= (1u << bit);
+        }
+
+        void unset_bitmap(std::vector<uint8_t>& bitmap, uint16_t idx) {
+            while (bitmap.size() < idx / 8 + 1) {
+                bitmap.emplace_back(0);
+            }
+            auto byte_idx     = idx / 8;
+            auto bit          = idx % 8;
+            bitmap[byte_idx] &= ~(1u << bit);
+        }
+
+        void insert_value(size_t out_idx, const valuet::value_t& value){
+
+            const auto& [col_idx, data_type] = output_attrs[out_idx];
+            auto& column = results.columns[out_idx];
+
+            switch (data_type) {
+
+                case DataType::INT32: {
+
+                    const size_t int_idx = static_cast<size_t>(out_to_int_idx[out_idx]);
+                    auto& buf = int_buffers[int_idx];
+
+                    if(value.is_null_int32()){
+                        if (4 + (buf.data.size()) * 4 + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        unset_bitmap(buf.bitmap, buf.num_rows);
+                        ++buf.num_rows;
+                    }
+                    else{
+                        if (4 + (buf.data.size() + 1) * 4 + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        set_bitmap(buf.bitmap, buf.num_rows);
+                        buf.data.emplace_back(value.intvalue);
+                        ++buf.num_rows;
+                    }
+                    break;
+                }
+
+                case DataType::VARCHAR: {
+
+                    const size_t varchar_idx = static_cast<size_t>(out_to_varchar_idx[out_idx]);
+                    auto& buf = varchar_buffers[varchar_idx];
+
+                    auto save_long_string = [&column](const std::string& str) {
+                        size_t offset     = 0;
+                        auto   first_page = true;
+                        while (offset < str.size()) {
+                            auto* page = column.new_page()->data;
+                            if (first_page) {
+                                *reinterpret_cast<uint16_t*>(page) = 0xffff;
+                                first_page                         = false;
+                            } else {
+                                *reinterpret_cast<uint16_t*>(page) = 0xfffe;
+                            }
+                            auto page_data_len = std::min(str.size() - offset, PAGE_SIZE - 4);
+                            *reinterpret_cast<uint16_t*>(page + 2) = page_data_len;
+                            memcpy(page + 4, str.data() + offset, page_data_len);
+                            offset += page_data_len;
+                        }
+                    };
+
+                    if(value.is_null_string()){
+                        if (4 + buf.offsets.size() * 2 + buf.data.size() + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        unset_bitmap(buf.bitmap, buf.num_rows);
+                        ++buf.num_rows;
+                    }
+                    else{
+                        // Materialize the string
+                        std::string materialized_string = materialize_string(plan, value.stringvalue);
+
+                        if (materialized_string.size() > PAGE_SIZE - 7) {
+                            if (buf.num_rows > 0) {
+                                buf.save_page(column);
+                            }
+                            save_long_string(materialized_string);
+                        }
+                        else{
+                            if (4 + (buf.offsets.size() + 1) * 2 + (buf.data.size() + materialized_string.size()) + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                                buf.save_page(column);
+                            }
+                            set_bitmap(buf.bitmap, buf.num_rows);
+                            buf.data.insert(buf.data.end(), materialized_string.begin(), materialized_string.end());
+                            buf.offsets.emplace_back(buf.data.size());
+                            ++buf.num_rows;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+
+        struct ThreadLocalWriter {
+            const Plan&                                      plan;
+            const std::vector<std::tuple<size_t, DataType>>& output_attrs;
+            const std::vector<int32_t>&                      out_to_int_idx;
+            const std::vector<int32_t>&                      out_to_varchar_idx;
+
+            ColumnarTable                  table;
+            std::vector<IntColumnBuffer>   int_buffers;
+            std::vector<VarcharColumnBuffer> varchar_buffers;
+
+            ThreadLocalWriter(const Plan& plan,
+                const std::vector<std::tuple<size_t, DataType>>& output_attrs,
+                const std::vector<int32_t>& out_to_int_idx,
+                const std::vector<int32_t>& out_to_varchar_idx)
+            : plan(plan)
+            , output_attrs(output_attrs)
+            , out_to_int_idx(out_to_int_idx)
+            , out_to_varchar_idx(out_to_varchar_idx) {
+                table.num_rows = 0;
+                table.columns.reserve(output_attrs.size());
+
+                // Allocate buffers only for the types that exist.
+                size_t int_count = 0;
+                size_t varchar_count = 0;
+                for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                    auto [_, dt] = output_attrs[out_idx];
+                    table.columns.emplace_back(dt);
+                    if (dt == DataType::INT32) ++int_count;
+                    else if (dt == DataType::VARCHAR) ++varchar_count;
+                }
+                int_buffers.reserve(int_count);
+                varchar_buffers.reserve(varchar_count);
+                for (size_t i = 0; i < int_count; ++i) int_buffers.emplace_back();
+                for (size_t i = 0; i < varchar_count; ++i) varchar_buffers.emplace_back();
+            }
+
+            static void set_bitmap(std::vector<uint8_t>& bitmap, uint16_t idx) {
+                while (bitmap.size() < idx / 8 + 1) {
+                    bitmap.emplace_back(0);
+                }
+                auto byte_idx     = idx / 8;
+                auto bit          = idx % 8;
+                bitmap[byte_idx] |= (1u << bit);
+            }
+
+            static void unset_bitmap(std::vector<uint8_t>& bitmap, uint16_t idx) {
+                while (bitmap.size() < idx / 8 + 1) {
+                    bitmap.emplace_back(0);
+                }
+                auto byte_idx     = idx / 8;
+                auto bit          = idx % 8;
+                bitmap[byte_idx] &= ~(1u << bit);
+            }
+
+            std::string materialize_string(const valuet::NewString& stringref) {
+                uint8_t  table_id   = stringref.table_id;
+                uint8_t  column_id  = stringref.column_id;
+                uint32_t page_id    = stringref.page_id;
+                uint16_t offset_idx = stringref.offset_idx;
+
+                const auto& column = plan.inputs[table_id].columns[column_id];
+                auto*       page   = column.pages[page_id]->data;
+
+                uint16_t num_rows = *reinterpret_cast<const uint16_t*>(page);
+                const uint16_t num_values = *reinterpret_cast<const uint16_t*>(page + 2);
+                const auto* offsets = reinterpret_cast<const uint16_t*>(page + 4);
+                const auto* data_base = reinterpret_cast<const char*>(page + 4 + num_values * 2);
+
+                if (num_rows != 0xffff && num_rows != 0xfffe) {
+                    uint16_t start  = (offset_idx == 0) ? 0 : offsets[offset_idx - 1];
+                    uint16_t length = offsets[offset_idx] - start;
+                    return std::string(data_base + start, length);
+                }
+
+                std::string result;
+                uint32_t current_page_id = page_id;
+
+                // first page (0xffff)
+                page = column.pages[current_page_id]->data;
+                uint16_t length = *reinterpret_cast<const uint16_t*>(page + 2);
+                const char* start = reinterpret_cast<const char*>(page + 4);
+                result.append(start, length);
+                current_page_id++;
+
+                // continuation pages (0xfffe)
+                while (current_page_id < column.pages.size()) {
+                    page = column.pages[current_page_id]->data;
+                    num_rows = *reinterpret_cast<const uint16_t*>(page);
+                    if (num_rows != 0xfffe) break;
+                    length = *reinterpret_cast<const uint16_t*>(page + 2);
+                    start = reinterpret_cast<const char*>(page + 4);
+                    result.append(start, length);
+                    current_page_id++;
+                }
+                return result;
+            }
+
+            void insert_value(size_t out_idx, const valuet::value_t& value) {
+                const auto& [col_idx, data_type] = output_attrs[out_idx];
+                auto& column = table.columns[out_idx];
+
+                switch (data_type) {
+                case DataType::INT32: {
+                    const size_t int_idx = static_cast<size_t>(out_to_int_idx[out_idx]);
+                    auto& buf = int_buffers[int_idx];
+
+                    if (value.is_null_int32()) {
+                        if (4 + (buf.data.size()) * 4 + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        unset_bitmap(buf.bitmap, buf.num_rows);
+                        ++buf.num_rows;
+                    } else {
+                        if (4 + (buf.data.size() + 1) * 4 + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        set_bitmap(buf.bitmap, buf.num_rows);
+                        buf.data.emplace_back(value.intvalue);
+                        ++buf.num_rows;
+                    }
+                    break;
+                }
+                case DataType::VARCHAR: {
+                    const size_t varchar_idx = static_cast<size_t>(out_to_varchar_idx[out_idx]);
+                    auto& buf = varchar_buffers[varchar_idx];
+
+                    auto save_long_string = [&column](const std::string& str) {
+                        size_t offset     = 0;
+                        auto   first_page = true;
+                        while (offset < str.size()) {
+                            auto* page = column.new_page()->data;
+                            if (first_page) {
+                                *reinterpret_cast<uint16_t*>(page) = 0xffff;
+                                first_page                         = false;
+                            } else {
+                                *reinterpret_cast<uint16_t*>(page) = 0xfffe;
+                            }
+                            auto page_data_len = std::min(str.size() - offset, PAGE_SIZE - 4);
+                            *reinterpret_cast<uint16_t*>(page + 2) = page_data_len;
+                            memcpy(page + 4, str.data() + offset, page_data_len);
+                            offset += page_data_len;
+                        }
+                    };
+
+                    if (value.is_null_string()) {
+                        if (4 + buf.offsets.size() * 2 + buf.data.size() + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                            buf.save_page(column);
+                        }
+                        unset_bitmap(buf.bitmap, buf.num_rows);
+                        ++buf.num_rows;
+                    } else {
+                        std::string materialized_string = materialize_string(value.stringvalue);
+
+                        if (materialized_string.size() > PAGE_SIZE - 7) {
+                            if (buf.num_rows > 0) {
+                                buf.save_page(column);
+                            }
+                            save_long_string(materialized_string);
+                        } else {
+                            if (4 + (buf.offsets.size() + 1) * 2 + (buf.data.size() + materialized_string.size()) + (buf.num_rows / 8 + 1) > PAGE_SIZE) {
+                                buf.save_page(column);
+                            }
+                            set_bitmap(buf.bitmap, buf.num_rows);
+                            buf.data.insert(buf.data.end(), materialized_string.begin(), materialized_string.end());
+                            buf.offsets.emplace_back(buf.data.size());
+                            ++buf.num_rows;
+                        }
+                    }
+                    break;
+                }
+                }
+            }
+
+            void finalize() {
+                size_t int_idx = 0;
+                size_t varchar_idx = 0;
+                for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                    auto [_, data_type] = output_attrs[out_idx];
+                    if (data_type == DataType::INT32) {
+                        auto& buf = int_buffers[int_idx++];
+                        if (buf.num_rows != 0) {
+                            buf.save_page(table.columns[out_idx]);
+                        }
+                    } else if (data_type == DataType::VARCHAR) {
+                        auto& buf = varchar_buffers[varchar_idx++];
+                        if (buf.num_rows != 0) {
+                            buf.save_page(table.columns[out_idx]);
+                        }
+                    }
+                }
+            }
+        };
+
+        void record_path(const char* path, size_t threads, bool build_is_left){
+            if (!join_profile) return;
+            join_profile->path = path;
+            join_profile->threads = threads;
+            join_profile->build_left = build_is_left;
+            join_profile->build_rows = build_is_left ? left[left_col].size() : right[right_col].size();
+            join_profile->probe_rows = build_is_left ? right[right_col].size() : left[left_col].size();
+        }
+
+        // Probe a built table (hash table or prebuilt index) with the other side, writing output pages
+        template <bool BuildLeft, typename Table>
+        void probe_into_results(const Table& table, size_t probe_threads){
+            const ExecuteResult& probe_side = BuildLeft ? right : left;
+            const size_t probe_col = BuildLeft ? right_col : left_col;
+            const size_t probe_rows = probe_side[probe_col].size();
+            morsel::Scheduler scheduler(probe_side[probe_col], probe_threads);
+
+            // the output goes to per-thread writers: the estimate only seeds the first morsels
+            const validity::Validity& valid = validity::of(probe_side[probe_col]);
+            const estimate::Estimate expected = estimate::sample(table, probe_side[probe_col]);
+            if (expected.valid()) {
+                scheduler.expect(expected.fanout);
+                if (join_profile) {
+                    join_profile->estimated_rows = expected.rows;
+                    join_profile->estimate_low = expected.low;
+                    join_profile->estimate_high = expected.high;
+                }
+            }
+
+            using Entry = std::remove_cv_t<std::remove_pointer_t<decltype(table.find_range(int32_t{}, std::declval<size_t&>()))>>;
+
+            // build-side outputs of payload tables come straight from the entry
+            auto emit = [&](auto& writer, const Entry& entry, size_t probe_idx) {
+                const size_t left_idx = BuildLeft ? entry.row_idx : probe_idx;
+                const size_t right_idx = BuildLeft ? probe_idx : entry.row_idx;
+                for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                    if constexpr (payload::has_payload<Entry>) {
+                        if (const int32_t slot = payload_slots[out_idx]; slot >= 0) {
+                            writer.insert_value(out_idx, entry.values[slot]);
+                            continue;
+                        }
+                    }
+                    auto [col_idx, _] = output_attrs[out_idx];
+                    if (col_idx < left.size()) {
+                        writer.insert_value(out_idx, left[col_idx][left_idx]);
+                    } else {
+                        writer.insert_value(out_idx, right[col_idx - left.size()][right_idx]);
+                    }
+                }
+            };
+
+            if (probe_threads <= 1 || scheduler.pages() < 2 || probe_rows < join_thresholds(context).parallel_probe_rows) {
+                profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::probe_ms));
+                perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::probe_counters));
+                uint64_t probes = 0, rejects = 0;
+                valid.for_each(0, probe_rows, [&](size_t probe_idx) {
+                    const int32_t key = probe_side[probe_col][probe_idx].intvalue;
+
+                    size_t len = 0;
+                    const auto* entries = table.find_range(key, len);
+                    ++probes;
+                    rejects += !entries;
+                    if (!entries || len == 0) return;
+
+                    for (size_t i = 0; i < len; ++i) {
+                        if (entries[i].key != key) continue;
+                        emit(*this, entries[i], probe_idx);
+                        results.num_rows++;
+                    }
+                });
+                if (join_profile) {
+                    join_profile->bloom_probes += probes;
+                    join_profile->bloom_rejects += rejects;
+                }
+                return;
+            }
+
+            // Work stealing over adaptive morsels + parallel materialization into per-thread tables.
+
+            std::vector<std::unique_ptr<ThreadLocalWriter>> writers;
+            writers.reserve(probe_threads);
+            for (size_t t = 0; t < probe_threads; ++t) {
+                writers.push_back(std::make_unique<ThreadLocalWriter>(plan, output_attrs, out_to_int_idx, out_to_varchar_idx));
+            }
+
+            std::vector<uint64_t> local_probes(probe_threads, 0), local_rejects(probe_threads, 0);
+
+            // match ranges too long for one thread, emitted by all threads after the pages
+            const size_t heavy_len = skew::heavy_range_entries();
+            std::vector<std::vector<skew::HeavyRange<Entry>>> local_heavy(probe_threads);
+
+            auto emit_range = [&](ThreadLocalWriter& writer, size_t probe_idx, int32_t key, const Entry* entries, size_t len) {
+                for (size_t i = 0; i < len; ++i) {
+                    if (entries[i].key != key) continue;
+                    emit(writer, entries[i], probe_idx);
+                    writer.table.num_rows++;
+                }
+            };
+
+            std::optional<profile::PhaseTimer> probe_timer(std::in_place, profile::phase(join_profile, &profile::JoinProfile::probe_ms));
+            std::vector<std::thread> probe_workers;
+            probe_workers.reserve(probe_threads);
+
+            for (size_t t = 0; t < probe_threads; ++t) {
+                probe_workers.emplace_back([&, t]() {
+                    perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::probe_counters));
+                    auto& writer = *writers[t];
+                    uint64_t probes = 0, rejects = 0;
+                    uint64_t rows_done = 0, matches_done = 0;
+                    size_t start = 0, end = 0;
+                    while (scheduler.claim(scheduler.morsel_pages(rows_done, matches_done), start, end)) {
+                        const size_t matches_before = writer.table.num_rows;
+                        valid.for_each(start, end, [&](size_t probe_idx) {
+                            const int32_t key = probe_side[probe_col][probe_idx].intvalue;
+
+                            size_t len = 0;
+                            const auto* entries = table.find_range(key, len);
+                            ++probes;
+                            rejects += !entries;
+                            if (!entries || len == 0) return;
+
+                            if (len > heavy_len) {
+                                local_heavy[t].push_back({probe_idx, key, entries, len});
+                                return;
+                            }
+                            emit_range(writer, probe_idx, key, entries, len);
+                        });
+                        rows_done += end - start;
+                        matches_done += writer.table.num_rows - matches_before;
+                    }
+                    local_probes[t] = probes;
+                    local_rejects[t] = rejects;
+                });
+            }
+            for (auto& t : probe_workers) t.join();
+
+            skew::run_slices(skew::split(local_heavy, heavy_len), probe_threads,
+                profile::counters(join_profile, &profile::JoinProfile::probe_counters),
+                [&](size_t t, const skew::HeavyRange<Entry>& slice) {
+                    emit_range(*writers[t], slice.probe_idx, slice.key, slice.entries, slice.len);
+                });
+            probe_timer.reset();
+            if (join_profile) {
+                for (size_t t = 0; t < probe_threads; ++t) {
+                    join_profile->bloom_probes += local_probes[t];
+                    join_profile->bloom_rejects += local_rejects[t];
+                }
+            }
+
+            // flush the thread local pages and move them to the result
+            profile::PhaseTimer materialize_timer(profile::phase(join_profile, &profile::JoinProfile::materialize_ms));
+            perfcounters::ThreadScope materialize_counters(profile::counters(join_profile, &profile::JoinProfile::materialize_counters));
+
+            for (size_t t = 0; t < probe_threads; ++t) {
+                auto& writer = *writers[t];
+                writer.finalize();
+                results.num_rows += writer.table.num_rows;
+                for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                    auto& dst = results.columns[out_idx];
+                    auto& src = writer.table.columns[out_idx];
+                    dst.pages.reserve(dst.pages.size() + src.pages.size());
+                    for (auto* p : src.pages) dst.pages.push_back(p);
+                    src.pages.clear();
+                }
+            }
+        }
+
+        auto run(){
+            out_to_int_idx.assign(output_attrs.size(), -1);
+            out_to_varchar_idx.assign(output_attrs.size(), -1);
+            int32_t int_counter = 0;
+            int32_t varchar_counter = 0;
+            for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                auto [_, data_type] = output_attrs[out_idx];
+                if (data_type == DataType::INT32) {
+                    out_to_int_idx[out_idx] = int_counter++;
+                } else if (data_type == DataType::VARCHAR) {
+                    out_to_varchar_idx[out_idx] = varchar_counter++;
+                }
+            }
+
+            for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                auto [col_idx, data_type] = output_attrs[out_idx];
+                results.columns.emplace_back(data_type);
+
+                if(data_type == DataType::INT32){
+                    int_buffers.emplace_back();
+                }
+                else if(data_type == DataType::VARCHAR){
+                    varchar_buffers.emplace_back();
+                }
+            }
+
+            size_t build_size = build_left ? left[left_col].size() : right[right_col].size();
+
+            const calibration::Thresholds& limits = join_thresholds(context);
+            const bool use_threaded = build_size >= limits.threaded_min_build;
+            const size_t join_budget = spill::memory_budget_bytes();
+            payload::Layout payload_layout = payload::layout(output_attrs, left.size(), build_left);
+
+            // prebuilt index over one of the key columns: skip the build
+            const indexfile::MappedIndex* left_index = context ? indexfile::find_index(context->indexes, context->identities, left[left_col]) : nullptr;
+            const indexfile::MappedIndex* right_index = (context && !left_index) ? indexfile::find_index(context->indexes, context->identities, right[right_col]) : nullptr;
+
+            if (left_index || right_index) {
+                size_t probe_threads = limits.threads;
+
+                record_path("index", probe_threads, left_index != nullptr);
+                if (left_index) {
+                    probe_into_results<true>(*left_index, probe_threads);
+                } else {
+                    probe_into_results<false>(*right_index, probe_threads);
+                }
+            } else if (join_budget && spill::build_footprint(build_size) > join_budget) {
+                // Out-of-core: grace join through spill files, output written serially
+                record_path("grace", 1, build_left);
+                profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::probe_ms));
+                const size_t build_col = build_left ? left_col : right_col;
+                const size_t probe_col = build_left ? right_col : left_col;
+                spill::grace_join((build_left ? left : right)[build_col], (build_left ? right : left)[probe_col], join_budget,
+                    [&](size_t build_idx, size_t probe_idx) {
+                        const size_t left_idx = build_left ? build_idx : probe_idx;
+                        const size_t right_idx = build_left ? probe_idx : build_idx;
+                        for (size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                            auto [col_idx, _] = output_attrs[out_idx];
+                            if (col_idx < left.size()) {
+                                insert_value(out_idx, left[col_idx][left_idx]);
+                            } else {
+                                insert_value(out_idx, right[col_idx - left.size()][right_idx]);
+                            }
+                        }
+                        results.num_rows++;
+                    });
+            } else if (engine != jointable::Engine::unchained) {
+                // another engine chosen for this join (SPC_JOIN_ENGINE): builds of any size go through it
+                size_t probe_threads = 1;
+                while (probe_threads < limits.threads) probe_threads *= 2;
+                record_path(jointable::name(engine), probe_threads, build_left);
+
+                const size_t build_threads = build_size >= limits.single_thread_build ? limits.threads : 1;
+                const ExecuteResult& build_side = build_left ? left : right;
+                const size_t build_col = build_left ? left_col : right_col;
+                jointable::with_table(engine, [&](auto& table) {
+                    {
+                        profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                        jointable::build(table, build_side[build_col], validity::of(build_side[build_col]), build_size, build_threads);
+                    }
+                    if (build_left) {
+                        probe_into_results<true>(table, probe_threads);
+                    } else {
+                        probe_into_results<false>(table, probe_threads);
+                    }
+                });
+            } else if (!use_threaded && payload::enabled(payload_layout, build_size)) {
+                // small build side with few output columns: the entries carry the build-side outputs
+                size_t probe_threads = limits.threads;
+
+                size_t probe_partitions = 1;
+                while (probe_partitions < probe_threads) probe_partitions *= 2;
+                probe_threads = probe_partitions;
+                record_path("unchained_payload", probe_threads, build_left);
+
+                const size_t build_threads = build_size >= limits.single_thread_build ? limits.threads : 1;
+                const ExecuteResult& build_side = build_left ? left : right;
+                const size_t build_col = build_left ? left_col : right_col;
+                payload_slots = std::move(payload_layout.slot_of_output);
+                payload::with_width(payload_layout.build_columns.size(), [&](auto width) {
+                    payload::Table<decltype(width)::value> payload_table;
+                    {
+                        profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                        payload::build(payload_table, build_side, build_col, validity::of(build_side[build_col]), payload_layout.build_columns,
+                            build_size, build_threads);
+                    }
+                    if (build_left) {
+                        probe_into_results<true>(payload_table, probe_threads);
+                    } else {
+                        probe_into_results<false>(payload_table, probe_threads);
+                    }
+                });
+            } else if (!use_threaded) {
+                ::UnchainedHashTable ht;
+                ht.reserve(build_size);
+
+                size_t probe_threads = limits.threads;
+
+                size_t probe_partitions = 1;
+                while (probe_partitions < probe_threads) probe_partitions *= 2;
+                probe_threads = probe_partitions;
+
+                // mid-sized builds: count, prefix sum and scatter in parallel, straight from the key column
+                const size_t build_threads = build_size >= limits.single_thread_build ? limits.threads : 1;
+                record_path(build_threads > 1 ? "unchained_parallel" : "unthreaded", probe_threads, build_left);
+
+                const ExecuteResult& build_side = build_left ? left : right;
+                const size_t build_col = build_left ? left_col : right_col;
+                const validity::Validity& build_valid = validity::of(build_side[build_col]);
+                if (build_threads > 1) {
+                    profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                    validity::dispatch(build_valid, [&](auto all_valid) {
+                        ht.build_parallel(build_size, build_threads, [&](size_t row_idx, ::HashEntry& entry) {
+                            if constexpr (!decltype(all_valid)::value) {
+                                if (!build_valid.test(row_idx)) return false;
+                            }
+                            entry = ::HashEntry(build_side[build_col][row_idx].intvalue, row_idx);
+                            return true;
+                        });
+                    });
+                } else {
+                    {
+                        profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::collect_ms));
+                        build_valid.for_each(0, build_size, [&](size_t row_idx) {
+                            ht.insert(build_side[build_col][row_idx].intvalue, row_idx);
+                        });
+                    }
+                    profile::PhaseTimer timer(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                    ht.finalize();
+                }
+
+                if (build_left) {
+                    probe_into_results<true>(ht, probe_threads);
+                } else {
+                    probe_into_results<false>(ht, probe_threads);
+                }
+            } else {
+
+                size_t num_threads = limits.threads;
+
+                size_t num_partitions = 1;
+                while(num_partitions < num_threads) num_partitions *= 2;
+                num_threads = num_partitions;
+                record_path("threaded", num_threads, build_left);
+
+                const ExecuteResult& build_side = build_left ? left : right;
+                const size_t build_col = build_left ? left_col : right_col;
+
+                // Phase 1: Collect
+                std::optional<profile::PhaseTimer> phase_timer(std::in_place, profile::phase(join_profile, &profile::JoinProfile::collect_ms));
+                const validity::Validity& build_valid = validity::of(build_side[build_col]);
+                threaded::GlobalAllocator globalAlloc;
+                std::vector<std::unique_ptr<threaded::TupleCollector>> collectors;
+                collectors.reserve(num_threads);
+                for(size_t i=0; i<num_threads; ++i) {
+                    collectors.push_back(std::make_unique<threaded::TupleCollector>(globalAlloc, num_partitions));
+                }
+
+                if (num_threads == 1) {
+                    perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::collect_counters));
+                    auto& collector = *collectors[0];
+                    build_valid.for_each(0, build_size, [&](size_t row_idx) {
+                        collector.consume(threaded::HashEntry(build_side[build_col][row_idx].intvalue, row_idx));
+                    });
+                } else {
+                    std::vector<std::thread> threads;
+                    size_t rows_per_thread = (build_size + num_threads - 1) / num_threads;
+
+                    for(size_t t = 0; t < num_threads; ++t){
+                        threads.emplace_back([&, t](){
+                            perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::collect_counters));
+                            size_t start = t * rows_per_thread;
+                            size_t end = std::min(start + rows_per_thread, build_size);
+
+                            auto& collector = *collectors[t];
+
+                            build_valid.for_each(start, end, [&](size_t row_idx) {
+                                collector.consume(threaded::HashEntry(build_side[build_col][row_idx].intvalue, row_idx));
+                            });
+                        });
+                    }
+
+                    for (auto& t : threads) t.join();
+                }
+
+                // Merge
+                phase_timer.emplace(profile::phase(join_profile, &profile::JoinProfile::merge_ms));
+                std::vector<threaded::Block*> partition_heads = threaded::merge_partitions(collectors, num_partitions);
+
+                // Phase 2/3: Count and Copy (one thread per partition)
+                size_t total_tuples = 0;
+                for(const auto& col : collectors){
+                    for(size_t c : col->counts) total_tuples += c;
+                }
+
+                phase_timer.emplace(profile::phase(join_profile, &profile::JoinProfile::build_ms));
+                threaded::FinalTable final_table(total_tuples, num_partitions);
+
+                std::vector<size_t> partition_offsets(num_partitions, 0);
+                size_t running_count = 0;
+
+                std::vector<size_t> global_partition_counts(num_partitions, 0);
+                for(size_t p=0; p<num_partitions; ++p){
+                    for(const auto& col : collectors) {
+                        global_partition_counts[p] += col->counts[p];
+                    }
+                }
+
+                for(size_t p=0; p<num_partitions; ++p) {
+                    partition_offsets[p] = running_count;
+                    running_count += global_partition_counts[p];
+                }
+
+                if (num_partitions == 1) {
+                    perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::build_counters));
+                    final_table.postProcessBuild(0, static_cast<uint64_t>(partition_offsets[0]), partition_heads);
+                } else {
+                    std::vector<std::thread> build_threads;
+                    build_threads.reserve(num_partitions);
+                    for (size_t p = 0; p < num_partitions; ++p) {
+                        build_threads.emplace_back([&, p]() {
+                            perfcounters::ThreadScope counters(profile::counters(join_profile, &profile::JoinProfile::build_counters));
+                            final_table.postProcessBuild(
+                                static_cast<uint64_t>(p),
+                                static_cast<uint64_t>(partition_offsets[p]),
+                                partition_heads);
+                        });
+                    }
+                    for (auto& t : build_threads) t.join();
+                }
+                phase_timer.reset();
+
+                // Probing - parallel with per-thread output tables
+                if (build_left) {
+                    probe_into_results<true>(final_table, num_threads);
+                } else {
+                    probe_into_results<false>(final_table, num_threads);
+                }
+            }
+
+            // Finalize all columns (flush remaining pages)
+            size_t int_idx = 0;
+            size_t varchar_idx = 0;
+            for(size_t out_idx = 0; out_idx < output_attrs.size(); ++out_idx) {
+                auto [col_idx, data_type] = output_attrs[out_idx];
+                if(data_type == DataType::INT32) {
+                    auto& buf = int_buffers[int_idx++];
+                    if(buf.num_rows != 0) {
+                        buf.save_page(results.columns[out_idx]);
+                    }
+                }
+                else if(data_type == DataType::VARCHAR) {
+                    auto& buf = varchar_buffers[varchar_idx++];
+                    if(buf.num_rows != 0) {
+                        buf.save_page(results.columns[out_idx]);
+                    }
+                }
+            }
+        }
+    };
+
+    inline ColumnarTable execute_hash_join_root(const Plan& plan, size_t node_idx, const JoinNode& join, const std::vector<std::tuple<size_t, DataType>>& output_attrs, ExecuteContext* context){
+        auto                           left_idx    = join.left;
+        auto                           right_idx   = join.right;
+        auto&                          left_node   = plan.nodes[left_idx];
+        auto&                          right_node  = plan.nodes[right_idx];
+        auto&                          left_types  = left_node.output_attrs;
+        auto&                          right_types = right_node.output_attrs;
+        auto                           left        = execute_impl(plan, left_idx, context);
+        auto                           right       = execute_impl(plan, right_idx, context);
+        ColumnarTable results;
+
+        // Compute build_left based on actual cardinalities (paper recommendation)
+        bool build_left = left[join.left_attr].size() <= right[join.right_attr].size();
+
+        JoinAlgorithmColumnar join_algorithm{.build_left = build_left,
+            .left                                        = left,
+            .right                                       = right,
+            .results                                     = results,
+            .left_col                                    = join.left_attr,
+            .right_col                                   = join.right_attr,
+            .output_attrs                                = output_attrs,
+            .plan                                        = plan,
+            .context                                     = context,
+            .join_profile                                = nullptr,
+            .engine                                      = context ? context->engines.for_node(node_idx) : jointable::Engine::unchained};
+
+        if (context && context->profiling) {
+            join_algorithm.join_profile = &context->profile.add_join();
+            join_algorithm.join_profile->node_idx = node_idx;
+            join_algorithm.join_profile->left_node = left_idx;
+            join_algorithm.join_profile->right_node = right_idx;
+            join_algorithm.join_profile->root = true;
+        }
+
+        // key columns of a scan share the bitmap of their input column
+        if (context) {
+            context->validities.attach(left[join.left_attr]);
+            context->validities.attach(right[join.right_attr]);
+        }
+
+        {
+            profile::PhaseTimer timer(profile::phase(join_algorithm.join_profile, &profile::JoinProfile::total_ms));
+            join_algorithm.run();
+        }
+
+        if (auto* join_profile = join_algorithm.join_profile) {
+            join_profile->output_rows = results.num_rows;
+            for (const auto& column : results.columns) join_profile->pages_allocated += column.pages.size();
+        }
+        return results;
+    }
+
+    inline ColumnarTable execute_impl_root(const Plan& plan, size_t node_idx, ExecuteContext* context){
+        auto& node = plan.nodes[node_idx];
+        auto& value = std::get<JoinNode>(node.data);
+        return execute_hash_join_root(plan, node_idx, value, node.output_attrs, context); // root is always join node
+    }
+
+} // namespace Contest
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+// NULL-skip cache of join key columns.
+// NULL is not stored in these bitmaps: it stays in-band as INT32_MIN (value_t, the
+// intermediate pages, the scans and the empty slots of the open addressing engines rely on
+// it), and the bitmaps are derived from it so build and probe loops can skip NULL keys. A
+// genuine INT32_MIN key is not supported: it reads as NULL everywhere and never joins. The
+// join writers do not produce bitmaps either; a nullable join output derives its own when a
+// later join first uses it as a key.
+// Bit r of a bitmap is set when row r is not NULL: referenced input columns take the bitmaps
+// of their sparse pages and test only the values those mark present, intermediate columns
+// test their values. A column without NULL rows drops its bitmap and is all valid.
+// A column caches its bitmap in column_t::valid_rows, computed at most once:
+// - join outputs copied from a join key or from an all valid column are all valid when the
+//   join produces them, nothing is scanned;
+// - key columns of a scan take the bitmap of their input column from the context's Cache,
+//   kept for the lifetime of the context for mapped tables (SPC_TABLE_DIR);
+// - any other key column computes it on first use.
+// Build and probe loops branch on all_valid once: null-free columns run loops without any
+// NULL test, the others walk the set bits a 64-row word at a time, NULL words skipped whole.
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <column_t.h>
+
+namespace validity{
+
+    struct Validity{
+        bool all_valid = true;
+        std::vector<uint64_t> words; // empty when all_valid
+
+        bool test(size_t row) const{
+            return (words[row >> 6] >> (row & 63)) & 1;
+        }
+
+        size_t count() const{
+            size_t valid = 0;
+            for(const uint64_t word : words) valid += static_cast<size_t>(std::popcount(word));
+            return valid;
+        }
+
+        // fn(row) for every non-NULL row of [begin, end), in row order
+        template <typename Fn>
+        void for_each(size_t begin, size_t end, Fn&& fn) const{
+            if(all_valid){
+                for(size_t row = begin; row < end; ++row) fn(row);
+                return;
+            }
+            if(begin >= end) return;
+            const size_t last = (end - 1) >> 6;
+            size_t w = begin >> 6;
+            uint64_t bits = words[w] & (~uint64_t{0} << (begin & 63));
+            while(true){
+                if(w == last) bits &= ~uint64_t{0} >> (63 - ((end - 1) & 63));
+                for(; bits; bits &= bits - 1) fn((w << 6) + static_cast<size_t>(std::countr_zero(bits)));
+                if(w == last) break;
+                bits = words[++w];
+            }
+        }
+    };
+
+    // Calls fn with std::true_type for a column without NULL rows, std::false_type otherwise
+    template <typename Fn>
+    void dispatch(const Validity& valid, Fn&& fn){
+        if(valid.all_valid) fn(std::true_type{});
+        else fn(std::false_type{});
+    }
+
+    // Shared bitmap of every column without NULL rows
+    inline const std::shared_ptr<const Validity>& all_rows_valid(){
+        static const std::shared_ptr<const Validity> valid = std::make_shared<const Validity>();
+        return valid;
+    }
+
+    // Scans the values of an INT32 key column
+    inline Validity compute(const columnt::column_t& column){
+        Validity valid;
+        const size_t rows = column.size();
+        valid.words.assign((rows + 63) / 64, 0);
+        uint64_t* words = valid.words.data();
+        auto set = [words](size_t row, bool bit) { words[row >> 6] |= static_cast<uint64_t>(bit) << (row & 63); };
+
+        if(!column.ref){
+            for(size_t first = 0, page = 0; first < rows; first += columnt::VALUES_PER_PAGE, ++page){
+                const valuet::value_t* data = column.pages[page]->data;
+                const size_t n = std::min(columnt::VALUES_PER_PAGE, rows - first);
+                for(size_t i = 0; i < n; ++i) set(first + i, !data[i].is_null_int32());
+            }
+        }
+        else if(column.ref_pages.empty()){
+            // every page dense: fixed number of rows per page
+            for(size_t first = 0, page = 0; first < rows; first += columnt::ROWS_PER_PAGE, ++page){
+                const int32_t* data = reinterpret_cast<const int32_t*>(column.ref->pages[page]->data + 4);
+                const size_t n = std::min(columnt::ROWS_PER_PAGE, rows - first);
+                for(size_t i = 0; i < n; ++i) set(first + i, data[i] != INT32_MIN);
+            }
+        }
+        else{
+            for(size_t p = 0; p + 1 < column.ref_pages.size(); ++p){
+                const columnt::RefPage& page = column.ref_pages[p];
+                const size_t n = column.ref_pages[p + 1].row_start - page.row_start;
+                const int32_t* data = reinterpret_cast<const int32_t*>(page.data + 4);
+                if(page.rank_offset == columnt::DENSE_PAGE){
+                    for(size_t i = 0; i < n; ++i) set(page.row_start + i, data[i] != INT32_MIN);
+                    continue;
+                }
+
+                // sparse page: the page bitmap marks the rows that have a value, in data order
+                const size_t bitmap_bytes = (n + 7) / 8;
+                const std::byte* bitmap = page.data + columnt::PAGE_SIZE - bitmap_bytes;
+                size_t data_idx = 0;
+                for(size_t byte_idx = 0; byte_idx < bitmap_bytes; byte_idx += 8){
+                    uint64_t word = 0;
+                    memcpy(&word, bitmap + byte_idx, std::min<size_t>(8, bitmap_bytes - byte_idx));
+                    for(; word; word &= word - 1){
+                        const size_t row = byte_idx * 8 + static_cast<size_t>(std::countr_zero(word));
+                        set(page.row_start + row, data[data_idx++] != INT32_MIN);
+                    }
+                }
+            }
+        }
+
+        if(valid.count() == rows) valid.words.clear();
+        else valid.all_valid = false;
+        return valid;
+    }
+
+    // Validity of an INT32 key column, computed on first use and kept in the column
+    inline const Validity& of(const columnt::column_t& column){
+        if(!column.valid_rows) column.valid_rows = std::make_shared<const Validity>(compute(column));
+        return *column.valid_rows;
+    }
+
+    // Bitmaps of the input columns scans reference, keyed by their first page. A scan references
+    // every row of its input column, so all scans of one column share its bitmap. Columns of
+    // kept (mapped) tables stay across queries, the others are dropped when a query starts.
+    struct Cache{
+        struct Entry{
+            std::shared_ptr<const Validity> valid;
+            size_t num_rows;
+        };
+        std::unordered_map<const Page*, Entry> columns;
+        std::unordered_set<const Page*> kept;
+
+        void keep(const Column& column){
+            if(!column.pages.empty()) kept.insert(column.pages.front());
+        }
+
+        // Gives a scanned key column the bitmap of its input column
+        void attach(const columnt::column_t& column){
+            if(column.valid_rows || !column.ref || column.ref->type != DataType::INT32 || column.ref->pages.empty()) return;
+            auto it = columns.find(column.ref->pages.front());
+            if(it == columns.end() || it->second.num_rows != column.size()){
+                it = columns.insert_or_assign(column.ref->pages.front(),
+                    Entry{std::make_shared<const Validity>(compute(column)), column.size()}).first;
+            }
+            column.valid_rows = it->second.valid;
+        }
+
+        void begin_query(){
+            std::erase_if(columns, [&](const auto& column) { return !kept.contains(column.first); });
+        }
+    };
+
+} // namespace validity
@@ -0,0 +1,86 @@
+#pragma once
+// Join output estimate from a probe sample.
+// Once the table is built, sample_rows() probe rows spread over the probe column (one random
+// row per stride) are looked up and their matches counted. The mean matches per row times
+// the probe rows predicts the output rows; low and high bound it with 95% confidence from the
+// sample variance (finite population corrected). The probe reserves its match buffers and
+// output page vectors from it and starts its first morsel at the estimated fanout.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+namespace estimate{
+
+    struct Estimate{
+        size_t rows = 0;
+        size_t low = 0;
+        size_t high = 0;
+        size_t sampled = 0; // 0: no estimate, the probe side was too small to sample
+        double fanout = 0;  // matches per probe row
+
+        bool valid() const{
+            return sampled > 0;
+        }
+    };
+
+    // SPC_ESTIMATE_SAMPLE overrides the sampled probe rows, 0 turns the estimate off.
+    // The sample variance needs two rows, a smaller sample is raised to 2.
+    inline size_t sample_rows(){
+        static const size_t rows = [] {
+            size_t value = 1024;
+            if(const char* v = std::getenv("SPC_ESTIMATE_SAMPLE")){
+                char* end = nullptr;
+                const unsigned long parsed = std::strtoul(v, &end, 10);
+                if(end != v) value = parsed == 0 ? 0 : std::max<size_t>(2, parsed);
+            }
+            return value;
+        }();
+        return rows;
+    }
+
+    // Probe sides below this many sample sizes are probed without an estimate
+    constexpr size_t MIN_PROBE_SAMPLES = 8;
+
+    template <typename Table, typename Column>
+    Estimate sample(const Table& table, const Column& probe_keys){
+        Estimate estimate;
+        const size_t n = sample_rows();
+        const size_t probe_rows = probe_keys.size();
+        if(n == 0 || probe_rows < n * MIN_PROBE_SAMPLES) return estimate;
+
+        const size_t stride = probe_rows / n;
+        uint64_t state = probe_rows * 0x9E3779B97F4A7C15ull + 1;
+        double sum = 0, sum_squares = 0;
+        for(size_t i = 0; i < n; ++i){
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const auto& key = probe_keys[i * stride + state % stride];
+            if(key.is_null_int32()) continue;
+
+            size_t len = 0;
+            const auto* entries = table.find_range(key.intvalue, len);
+            size_t matches = 0;
+            for(size_t e = 0; entries && e < len; ++e) matches += entries[e].key == key.intvalue;
+            sum += static_cast<double>(matches);
+            sum_squares += static_cast<double>(matches) * static_cast<double>(matches);
+        }
+
+        const double samples = static_cast<double>(n);
+        const double total = static_cast<double>(probe_rows);
+        const double mean = sum / samples;
+        const double variance = std::max(0.0, (sum_squares - sum * mean) / (samples - 1));
+        const double margin = 1.96 * total * std::sqrt(variance / samples * (total - samples) / (total - 1));
+
+        estimate.sampled = n;
+        estimate.fanout = mean;
+        estimate.rows = static_cast<size_t>(mean * total);
+        estimate.low = static_cast<size_t>(std::max(0.0, mean * total - margin));
+        estimate.high = static_cast<size_t>(mean * total + margin);
+        return estimate;
+    }
+
+} // namespace estimate
@@ -0,0 +1,99 @@
+#pragma once
+// Adaptive probe morsels.
+// A morsel is a run of whole pages of the probe column. Every worker sizes its next
+// morsel from what it measured so far (probe rows and matches emitted), aiming at
+// target_work() units of work per morsel: cheap miss-only probes get long morsels and
+// little atomic traffic, high-fanout probes get single pages and a balanced tail.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <column_t.h>
+
+namespace morsel{
+
+    constexpr size_t MAX_MORSEL_PAGES = 64;
+
+    // SPC_MORSEL_WORK overrides the work per morsel, in probe rows + matches
+    inline size_t target_work(){
+        static const size_t work = [] {
+            size_t value = 32768;
+            if(const char* v = std::getenv("SPC_MORSEL_WORK")){
+                char* end = nullptr;
+                const unsigned long parsed = std::strtoul(v, &end, 10);
+                if(end != v && parsed > 0) value = parsed;
+            }
+            return value;
+        }();
+        return work;
+    }
+
+    // Row boundaries of the pages of a column: intermediate pages, dense input pages or the
+    // variable sized input pages of a sparse reference
+    struct PageLayout{
+        const columnt::column_t& column;
+
+        size_t pages() const{
+            if(!column.ref) return (column.size() + columnt::VALUES_PER_PAGE - 1) / columnt::VALUES_PER_PAGE;
+            if(column.ref_pages.empty()) return (column.size() + columnt::ROWS_PER_PAGE - 1) / columnt::ROWS_PER_PAGE;
+            return column.ref_pages.size() - 1; // last entry is the sentinel
+        }
+
+        // first row of page (the column size for page == pages())
+        size_t row_start(size_t page) const{
+            if(!column.ref) return std::min(page * columnt::VALUES_PER_PAGE, column.size());
+            if(column.ref_pages.empty()) return std::min(page * columnt::ROWS_PER_PAGE, column.size());
+            return column.ref_pages[page].row_start;
+        }
+    };
+
+    class Scheduler{
+    public:
+        Scheduler(const columnt::column_t& column, size_t threads)
+            : layout{column}, num_pages(layout.pages()), threads(std::max<size_t>(1, threads)), work(target_work()) {}
+
+        size_t pages() const{
+            return num_pages;
+        }
+
+        // Matches per probe row expected before any were measured (negative: unknown)
+        void expect(double matches_per_row){
+            expected_fanout = matches_per_row;
+        }
+
+        // Morsel size for a worker that saw matches over rows so far
+        size_t morsel_pages(uint64_t rows, uint64_t matches) const{
+            if(num_pages == 0 || (rows == 0 && expected_fanout < 0)) return 1;
+            const double fanout = rows ? static_cast<double>(matches) / static_cast<double>(rows) : expected_fanout;
+            const double work_per_row = 1.0 + fanout;
+            const double rows_per_page = static_cast<double>(layout.column.size()) / static_cast<double>(num_pages);
+            size_t wanted = static_cast<size_t>(static_cast<double>(work) / (work_per_row * rows_per_page));
+
+            // no more than a fair share of the remaining pages, so the last morsels stay balanced
+            const size_t claimed = std::min(next_page.load(std::memory_order_relaxed), num_pages);
+            wanted = std::min(wanted, (num_pages - claimed) / (threads * 2));
+            return std::clamp<size_t>(wanted, 1, MAX_MORSEL_PAGES);
+        }
+
+        // Claims the next count pages; false once every page is taken
+        bool claim(size_t count, size_t& begin, size_t& end){
+            const size_t page = next_page.fetch_add(count, std::memory_order_relaxed);
+            if(page >= num_pages) return false;
+            begin = layout.row_start(page);
+            end = layout.row_start(std::min(page + count, num_pages));
+            return true;
+        }
+
+    private:
+        PageLayout layout;
+        size_t num_pages;
+        size_t threads;
+        size_t work;
+        double expected_fanout = -1;
+        std::atomic<size_t> next_page{0};
+    };
+
+} // namespace morsel
@@ -0,0 +1,168 @@
+#pragma once
+// Per-operator execution profile (EXPLAIN ANALYZE).
+// Every hash join records its path, row counts and phase times into the query
+// profile of the execution context. Disabled, a join only checks one null pointer
+// per phase, and the probe loops keep their reject counters in registers.
+// Hardware counters per phase are added when the kernel allows perf_event_open.
+
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <perf_counters.h>
+
+namespace profile{
+
+    struct JoinProfile{
+        size_t node_idx = 0;
+        size_t left_node = 0;
+        size_t right_node = 0;
+        bool root = false;
+        const char* path = "";     // "unthreaded", "unchained_parallel", "unchained_payload", "threaded", "index", "grace"
+                                   // or the engine name (jointable::name)
+        bool build_left = false;
+        size_t threads = 1;
+
+        size_t build_rows = 0;
+        size_t probe_rows = 0;
+        size_t output_rows = 0;
+        size_t estimated_rows = 0;  // output estimate from the probe sample and its 95% bounds,
+        size_t estimate_low = 0;    // all 0 when the probe side was not sampled
+        size_t estimate_high = 0;
+        uint64_t bloom_probes = 0;  // probe keys that reached find_range
+        uint64_t bloom_rejects = 0; // of which the bloom filter rejected
+        size_t pages_allocated = 0; // output pages of the join
+
+        // wall time per phase, milliseconds
+        double collect_ms = 0;      // build tuples into thread local partitions (unthreaded: into the table)
+        double merge_ms = 0;        // link partitions across threads
+        double build_ms = 0;        // postProcessBuild / finalize
+        double probe_ms = 0;
+        double materialize_ms = 0;
+        double total_ms = 0;
+
+        // hardware counters of every thread of a phase
+        perfcounters::PhaseCounters collect_counters;
+        perfcounters::PhaseCounters build_counters;
+        perfcounters::PhaseCounters probe_counters;
+        perfcounters::PhaseCounters materialize_counters;
+    };
+
+    struct QueryProfile{
+        size_t query = 0;
+        double total_ms = 0;
+        std::deque<JoinProfile> joins; // stable addresses while a join fills its entry
+
+        JoinProfile& add_join(){
+            return joins.emplace_back();
+        }
+
+        void reset(size_t query_idx){
+            query = query_idx;
+            total_ms = 0;
+            joins.clear();
+        }
+    };
+
+    // Adds the wall time of its scope to *target (nothing when target is null)
+    struct PhaseTimer{
+        double* target;
+        std::chrono::steady_clock::time_point begin;
+
+        explicit PhaseTimer(double* target_ms) : target(target_ms){
+            if(target) begin = std::chrono::steady_clock::now();
+        }
+
+        ~PhaseTimer(){
+            if(target) *target += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+    };
+
+    // member pointer of a phase, or null when profiling is off
+    inline double* phase(JoinProfile* join, double JoinProfile::* field){
+        return join ? &(join->*field) : nullptr;
+    }
+
+    // counters of a phase, or null when profiling is off or the counters are unavailable
+    inline perfcounters::PhaseCounters* counters(JoinProfile* join, perfcounters::PhaseCounters JoinProfile::* field){
+        if(!join || perfcounters::disabled.load(std::memory_order_relaxed)) return nullptr;
+        return &(join->*field);
+    }
+
+    // printf onto the end of out, however long the result gets
+    inline void appendf(std::string& out, const char* format, ...){
+        va_list args, again;
+        va_start(args, format);
+        va_copy(again, args);
+        const int len = std::vsnprintf(nullptr, 0, format, args);
+        va_end(args);
+        if(len > 0){
+            const size_t at = out.size();
+            out.resize(at + static_cast<size_t>(len) + 1);
+            std::vsnprintf(out.data() + at, static_cast<size_t>(len) + 1, format, again);
+            out.resize(at + static_cast<size_t>(len));
+        }
+        va_end(again);
+    }
+
+    inline void counters_json(std::string& out, const char* name, const perfcounters::PhaseCounters& phase){
+        if(phase.threads == 0) return;
+        appendf(out, "%s\"%s\": {\"threads\": %zu", out.back() == '{' ? "" : ", ", name, phase.threads);
+        for(size_t e = 0; e < perfcounters::NUM_EVENTS; ++e){
+            if(!phase.total.present[e]) continue;
+            appendf(out, ", \"%s\": %llu", perfcounters::event_name(e), static_cast<unsigned long long>(phase.total.values[e]));
+        }
+        out += "}";
+    }
+
+    inline std::string to_json(const QueryProfile& query){
+        std::string out;
+        appendf(out, "{\"query\": %zu, \"total_ms\": %.3f, \"joins\": [", query.query, query.total_ms);
+        for(size_t i = 0; i < query.joins.size(); ++i){
+            const JoinProfile& j = query.joins[i];
+            const double reject_rate = j.bloom_probes ? static_cast<double>(j.bloom_rejects) / static_cast<double>(j.bloom_probes) : 0.0;
+            appendf(out,
+                "%s\n  {\"node\": %zu, \"left\": %zu, \"right\": %zu, \"root\": %s, \"path\": \"%s\", \"build_side\": \"%s\", \"threads\": %zu, "
+                "\"build_rows\": %zu, \"probe_rows\": %zu, \"output_rows\": %zu, \"estimated_rows\": {\"low\": %zu, \"rows\": %zu, \"high\": %zu}, "
+                "\"bloom_probes\": %llu, \"bloom_reject_rate\": %.4f, "
+                "\"pages_allocated\": %zu, \"phases_ms\": {\"collect\": %.3f, \"merge\": %.3f, \"build\": %.3f, \"probe\": %.3f, "
+                "\"materialize\": %.3f}, \"total_ms\": %.3f",
+                i ? "," : "", j.node_idx, j.left_node, j.right_node, j.root ? "true" : "false", j.path, j.build_left ? "left" : "right",
+                j.threads, j.build_rows, j.probe_rows, j.output_rows, j.estimate_low, j.estimated_rows, j.estimate_high,
+                static_cast<unsigned long long>(j.bloom_probes), reject_rate,
+                j.pages_allocated, j.collect_ms, j.merge_ms, j.build_ms, j.probe_ms, j.materialize_ms, j.total_ms);
+
+            out += ", \"counters\": {";
+            counters_json(out, "collect", j.collect_counters);
+            counters_json(out, "build", j.build_counters);
+            counters_json(out, "probe", j.probe_counters);
+            counters_json(out, "materialize", j.materialize_counters);
+            out += "}}";
+        }
+        out += "\n]}\n";
+        return out;
+    }
+
+    // SPC_PROFILE=1 (or "stderr") => stderr, any other value is a file the profiles are appended to
+    inline void dump(const QueryProfile& query, const std::string& target){
+        const std::string json = to_json(query);
+        if(target == "1" || target == "stderr"){
+            fputs(json.c_str(), stderr);
+            return;
+        }
+        if(FILE* f = fopen(target.c_str(), "a")){
+            fputs(json.c_str(), f);
+            fclose(f);
+        }
+        else{
+            fprintf(stderr, "profile: cannot open %s\n", target.c_str());
+        }
+    }
+
+} // namespace profile
@@ -0,0 +1,230 @@
+#pragma once
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <value_t.h>
+#include <page_pool.h>
+#include <plan.h>
+
+namespace columnt{
+
+    constexpr size_t PAGE_SIZE = 8192;
+    constexpr size_t VALUES_PER_PAGE = PAGE_SIZE / sizeof(valuet::value_t);
+
+    // For INT32 page:
+    // header + data + bitman <= 8192
+    // 4 + 4*n + ceil(n/8) <= 8192
+    // n <= 1984.97
+    // max(n) = 1984
+    constexpr size_t ROWS_PER_PAGE = 1984;
+
+    // no rank index => dense page, values are read in place
+    constexpr uint32_t DENSE_PAGE = UINT32_MAX;
+
+    struct alignas(8) Intermediate_Page{
+        valuet::value_t data[VALUES_PER_PAGE];
+
+        Intermediate_Page() = default;
+    };
+
+    // pages come from the context page pool and go back to it in bulk
+    inline Intermediate_Page* new_intermediate_page(){
+        return new (pagepool::acquire()) Intermediate_Page();
+    }
+
+    // One input page referenced by a column_t
+    struct RefPage{
+        const std::byte* data;
+        size_t row_start;     // first row of the page inside the column
+        uint32_t page_id;     // index of the page inside the input column
+        uint32_t rank_offset; // where the rank index of a sparse page starts (DENSE_PAGE for dense pages)
+    };
+
+    struct column_t{
+        std::vector<Intermediate_Page*> pages;
+        size_t num_values = 0;
+        Column* ref = nullptr;
+        uint8_t ref_table_id = 0;
+        uint8_t ref_column_id = 0;
+
+        // Hybrid reference state (empty when every page of an INT32 column is dense)
+        std::vector<RefPage> ref_pages;        // pages holding rows + a sentinel holding num_values
+        std::vector<uint32_t> ref_block_page;  // page that holds row (block * ROWS_PER_PAGE)
+        std::vector<uint16_t> ref_ranks;       // set bits before every 64-row word of a sparse page
+
+        column_t() = default;
+
+        ~column_t(){
+            if(!ref){
+                pagepool::release(pages);
+            }
+        }
+
+        column_t(column_t&& other) noexcept : pages(std::move(other.pages)), num_values(other.num_values), ref(other.ref),
+            ref_table_id(other.ref_table_id), ref_column_id(other.ref_column_id),
+            ref_pages(std::move(other.ref_pages)), ref_block_page(std::move(other.ref_block_page)), ref_ranks(std::move(other.ref_ranks)){
+            other.num_values = 0;
+            other.ref = nullptr;
+        }
+
+        column_t(const column_t&) = delete;
+        column_t& operator=(const column_t&) = delete;
+        column_t& operator=(column_t&&) = delete;
+
+        void push_back(const valuet::value_t& value){
+            size_t page_idx = num_values / VALUES_PER_PAGE;
+            size_t offset = num_values % VALUES_PER_PAGE;
+
+            if(page_idx >= pages.size()){
+                pages.push_back(new_intermediate_page());
+            }
+
+            pages[page_idx]->data[offset] = value;
+            num_values++;
+        }
+
+        size_t size() const{
+            return num_values;
+        }
+
+        // By value: a reference column has no value_t in memory, and a cache shared between
+        // reads would make two rows read at the same time alias each other
+        valuet::value_t operator[](size_t idx) const{
+            if(!ref){
+                size_t page_idx = idx / VALUES_PER_PAGE;
+                size_t offset = idx % VALUES_PER_PAGE;
+                return pages[page_idx]->data[offset];
+            }
+            return ref_value(idx);
+        }
+
+        valuet::value_t ref_value(size_t idx) const{
+            // every page of an INT32 column is dense: fixed number of rows per page
+            if(ref_pages.empty()){
+                size_t page_idx = idx / ROWS_PER_PAGE;
+                size_t offset = idx % ROWS_PER_PAGE;
+
+                const std::byte* page = ref->pages[page_idx]->data;
+                const int32_t* data_begin = reinterpret_cast<const int32_t*>(page + 4);
+                return valuet::value_t(data_begin[offset]);
+            }
+
+            const RefPage& page = ref_pages[find_ref_page(idx)];
+            size_t data_idx = 0;
+            bool valid = ref_data_idx(page, idx - page.row_start, data_idx);
+
+            if(ref->type == DataType::INT32){
+                if(!valid) return valuet::value_t::null_int32();
+                const int32_t* data_begin = reinterpret_cast<const int32_t*>(page.data + 4);
+                return valuet::value_t(data_begin[data_idx]);
+            }
+
+            // VARCHAR: synthesize the string reference, materialization reads the page later
+            if(!valid) return valuet::value_t::null_string();
+            return valuet::value_t(valuet::NewString(ref_table_id, ref_column_id, page.page_id, static_cast<uint16_t>(data_idx)));
+        }
+
+        // Index of the referenced page that holds row idx
+        size_t find_ref_page(size_t idx) const{
+            size_t block = idx / ROWS_PER_PAGE;
+            size_t lo = ref_block_page[block];
+            size_t hi = (block + 1 < ref_block_page.size()) ? ref_block_page[block + 1] : ref_pages.size() - 2;
+            if(lo == hi) return lo;
+
+            // full INT32 pages give at most two candidates, VARCHAR pages may give more
+            auto it = std::upper_bound(ref_pages.begin() + lo + 1, ref_pages.begin() + hi + 1, idx,
+                [](size_t row, const RefPage& page){ return row < page.row_start; });
+            return static_cast<size_t>(it - ref_pages.begin()) - 1;
+        }
+
+        // Position of a row inside the data of its page, false for NULL
+        bool ref_data_idx(const RefPage& page, size_t row, size_t& data_idx) const{
+            if(page.rank_offset == DENSE_PAGE){
+                data_idx = row;
+                return true;
+            }
+
+            // sparse page: rank of the row inside the bitmap gives its data index
+            uint16_t num_rows = *reinterpret_cast<const uint16_t*>(page.data);
+            size_t bitmap_bytes = (num_rows + 7) / 8;
+            const std::byte* bitmap = page.data + PAGE_SIZE - bitmap_bytes;
+
+            size_t word_idx = row / 64;
+            uint64_t word = 0;
+            memcpy(&word, bitmap + word_idx * 8, std::min<size_t>(8, bitmap_bytes - word_idx * 8));
+
+            uint64_t bit = row % 64;
+            if(!((word >> bit) & 1u)) return false;
+
+            uint64_t below = word & ((1ull << bit) - 1);
+            data_idx = ref_ranks[page.rank_offset + word_idx] + static_cast<size_t>(std::popcount(below));
+            return true;
+        }
+
+        // Reference an input column without copying it.
+        // Dense pages are read in place, sparse pages get a rank index over their bitmap.
+        // Long string pages count as one dense row, their continuation pages hold no rows.
+        void reference_column(const ColumnarTable& table, size_t in_col_idx, uint8_t table_id){
+            ref = const_cast<Column*>(&table.columns[in_col_idx]);
+            num_values = table.num_rows;
+            ref_table_id = table_id;
+            ref_column_id = static_cast<uint8_t>(in_col_idx);
+
+            if(ref->type == DataType::INT32){
+                bool dense_column = true;
+                for(auto* page : ref->pages){
+                    auto num_rows = *reinterpret_cast<const uint16_t*>(page->data);
+                    auto num_values = *reinterpret_cast<const uint16_t*>(page->data + 2);
+                    if(num_rows != num_values){ // sparse page spotted
+                        dense_column = false;
+                        break;
+                    }
+                }
+                if(dense_column) return;
+            }
+
+            ref_pages.reserve(ref->pages.size() + 1);
+            ref_block_page.reserve(num_values / ROWS_PER_PAGE + 1);
+
+            size_t row_start = 0;
+            for(uint32_t page_id = 0; page_id < ref->pages.size(); ++page_id){
+                const std::byte* page = ref->pages[page_id]->data;
+                uint16_t num_rows = *reinterpret_cast<const uint16_t*>(page);
+                uint16_t num_values = *reinterpret_cast<const uint16_t*>(page + 2);
+
+                if(num_rows == 0xfffe) continue; // long string continuation page
+                if(num_rows == 0xffff){          // long string page
+                    num_rows = 1;
+                    num_values = 1;
+                }
+                if(num_rows == 0) continue;
+
+                uint32_t rank_offset = DENSE_PAGE;
+                if(num_rows != num_values){
+                    rank_offset = static_cast<uint32_t>(ref_ranks.size());
+                    size_t bitmap_bytes = (num_rows + 7) / 8;
+                    const std::byte* bitmap = page + PAGE_SIZE - bitmap_bytes;
+                    uint16_t rank = 0;
+                    for(size_t byte_idx = 0; byte_idx < bitmap_bytes; byte_idx += 8){
+                        ref_ranks.push_back(rank);
+                        uint64_t word = 0;
+                        memcpy(&word, bitmap + byte_idx, std::min<size_t>(8, bitmap_bytes - byte_idx));
+                        rank += static_cast<uint16_t>(std::popcount(word));
+                    }
+                }
+
+                // blocks whose first row falls inside this page
+                uint32_t ref_idx = static_cast<uint32_t>(ref_pages.size());
+                while(ref_block_page.size() * ROWS_PER_PAGE < row_start + num_rows){
+                    ref_block_page.push_back(ref_idx);
+                }
+
+                ref_pages.push_back(RefPage{page, row_start, page_id, rank_offset});
+                row_start += num_rows;
+            }
+            ref_pages.push_back(RefPage{nullptr, row_start, 0, DENSE_PAGE});
+        }
+    };
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <page_pool.h>
+
+namespace Contest {
+
+    // State kept across queries: created by build_context(), passed to every execute()
+    struct ExecuteContext{
+        pagepool::PagePool page_pool;
+
+        explicit ExecuteContext(size_t page_pool_bytes) : page_pool(page_pool_bytes) {}
+    };
+
+} // namespace Contest
@@ -0,0 +1,213 @@
+#pragma once
+// Recycling pool for 8 KB intermediate pages.
+// Pages are carved out of 2 MB slabs owned by the execution context and cached
+// per thread, so a query allocates and frees its pages without going through malloc.
+// Slabs are 2 MB aligned and registered with their pool: a released page goes back to the
+// pool that carved it, and a page that came from ::operator new (no pool was active when it
+// was acquired) goes back to ::operator delete, whichever pool is active at release.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace pagepool{
+
+    constexpr size_t PAGE_BYTES = 8192;
+    constexpr size_t SLAB_SIZE = (2u << 20); // 2 MB
+    constexpr size_t PAGES_PER_SLAB = SLAB_SIZE / PAGE_BYTES;
+    constexpr size_t BATCH_PAGES = 64;        // pages moved between a thread and the pool at once
+    constexpr size_t MAX_LOCAL_PAGES = 1024;  // 8 MB cached per thread before pages go back to the pool
+
+    struct PagePool;
+
+    // Live slabs of every pool, sorted by address
+    struct SlabRegistry{
+        std::mutex mutex;
+        std::vector<std::pair<uintptr_t, PagePool*>> slabs;
+
+        void add(const void* slab, PagePool* pool){
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto entry = std::make_pair(reinterpret_cast<uintptr_t>(slab), pool);
+            slabs.insert(std::lower_bound(slabs.begin(), slabs.end(), entry), entry);
+        }
+
+        void remove(const void* slab){
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = std::lower_bound(slabs.begin(), slabs.end(), std::make_pair(reinterpret_cast<uintptr_t>(slab), static_cast<PagePool*>(nullptr)));
+            if(it != slabs.end() && it->first == reinterpret_cast<uintptr_t>(slab)) slabs.erase(it);
+        }
+
+        // Pool whose slab holds page, nullptr for pages from ::operator new (caller holds mutex)
+        PagePool* owner(const void* page) const{
+            const uintptr_t slab = reinterpret_cast<uintptr_t>(page) & ~static_cast<uintptr_t>(SLAB_SIZE - 1);
+            auto it = std::lower_bound(slabs.begin(), slabs.end(), std::make_pair(slab, static_cast<PagePool*>(nullptr)));
+            return it != slabs.end() && it->first == slab ? it->second : nullptr;
+        }
+    };
+
+    inline SlabRegistry slab_registry;
+
+    struct PagePool{
+        std::mutex mutex;
+        std::vector<void*> slabs;
+        std::vector<void*> free_pages;
+        size_t max_slabs;
+
+        explicit PagePool(size_t max_retained_bytes) : max_slabs(std::max<size_t>(1, max_retained_bytes / SLAB_SIZE)) {}
+
+        ~PagePool(){
+            for(void* slab : slabs){
+                slab_registry.remove(slab);
+                std::free(slab);
+            }
+        }
+
+        PagePool(const PagePool&) = delete;
+        PagePool& operator=(const PagePool&) = delete;
+
+        void add_slab(){
+            auto* slab = static_cast<std::byte*>(std::aligned_alloc(SLAB_SIZE, SLAB_SIZE));
+            if(!slab) throw std::bad_alloc();
+            slabs.push_back(slab);
+            slab_registry.add(slab, this);
+            for(size_t i = PAGES_PER_SLAB; i > 0; --i){
+                free_pages.push_back(slab + (i - 1) * PAGE_BYTES);
+            }
+        }
+
+        // move a batch of free pages to a thread cache
+        void refill(std::vector<void*>& cache){
+            std::lock_guard<std::mutex> lock(mutex);
+            if(free_pages.empty()) add_slab();
+            size_t n = std::min(BATCH_PAGES, free_pages.size());
+            cache.insert(cache.end(), free_pages.end() - n, free_pages.end());
+            free_pages.resize(free_pages.size() - n);
+        }
+
+        // take back every page of a thread cache beyond the first `keep`
+        void give_back(std::vector<void*>& cache, size_t keep){
+            if(cache.size() <= keep) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            free_pages.insert(free_pages.end(), cache.begin() + keep, cache.end());
+            cache.resize(keep);
+        }
+
+        void give_back_page(void* page){
+            std::lock_guard<std::mutex> lock(mutex);
+            free_pages.push_back(page);
+        }
+
+        bool over_budget(){
+            std::lock_guard<std::mutex> lock(mutex);
+            return slabs.size() > max_slabs;
+        }
+
+        // Between queries: release the slabs above the retained budget.
+        // Only possible once every page is back, otherwise we keep everything.
+        // free_pages only ever holds pages of our slabs (release sorts them by owner).
+        void trim(){
+            std::lock_guard<std::mutex> lock(mutex);
+            if(slabs.size() <= max_slabs) return;
+            if(free_pages.size() != slabs.size() * PAGES_PER_SLAB) return;
+
+            for(size_t i = max_slabs; i < slabs.size(); ++i){
+                slab_registry.remove(slabs[i]);
+                std::free(slabs[i]);
+            }
+            slabs.resize(max_slabs);
+
+            free_pages.clear();
+            for(void* slab : slabs){
+                for(size_t i = PAGES_PER_SLAB; i > 0; --i){
+                    free_pages.push_back(static_cast<std::byte*>(slab) + (i - 1) * PAGE_BYTES);
+                }
+            }
+        }
+    };
+
+    // pool of the current execution context (nullptr => plain new/delete)
+    inline std::atomic<PagePool*> active_pool{nullptr};
+    inline std::atomic<uint64_t> active_generation{0};
+
+    inline void activate(PagePool* pool){
+        active_generation.fetch_add(1, std::memory_order_acq_rel);
+        active_pool.store(pool, std::memory_order_release);
+    }
+
+    inline void deactivate(){
+        active_pool.store(nullptr, std::memory_order_release);
+        active_generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    struct LocalCache{
+        PagePool* pool = nullptr;
+        uint64_t generation = 0;
+        std::vector<void*> pages;
+
+        ~LocalCache(){ flush(); }
+
+        // pages cached for a pool that is gone were freed with its slabs
+        void sync(){
+            PagePool* current = active_pool.load(std::memory_order_acquire);
+            uint64_t current_generation = active_generation.load(std::memory_order_acquire);
+            if(pool != current || generation != current_generation){
+                pages.clear();
+                pool = current;
+                generation = current_generation;
+            }
+        }
+
+        void flush(){
+            sync();
+            if(pool) pool->give_back(pages, 0);
+        }
+    };
+
+    inline thread_local LocalCache local_cache;
+
+    inline void* acquire(){
+        LocalCache& cache = local_cache;
+        cache.sync();
+        if(!cache.pool) return ::operator new(PAGE_BYTES);
+
+        if(cache.pages.empty()) cache.pool->refill(cache.pages);
+        void* page = cache.pages.back();
+        cache.pages.pop_back();
+        return page;
+    }
+
+    // return all pages of a dying column at once: pages of the active pool go to the thread
+    // cache, pages of another pool to its free list, the others to ::operator delete
+    template <typename Page>
+    inline void release(const std::vector<Page*>& pages){
+        static_assert(sizeof(Page) <= PAGE_BYTES);
+        if(pages.empty()) return;
+
+        LocalCache& cache = local_cache;
+        cache.sync();
+        std::vector<std::pair<PagePool*, void*>> foreign;
+        {
+            std::lock_guard<std::mutex> lock(slab_registry.mutex);
+            for(auto* page : pages){
+                PagePool* owner = slab_registry.owner(page);
+                if(owner && owner == cache.pool) cache.pages.push_back(page);
+                else foreign.emplace_back(owner, page);
+            }
+        }
+        for(auto [owner, page] : foreign){
+            if(owner) owner->give_back_page(page);
+            else ::operator delete(page);
+        }
+
+        if(cache.pool && cache.pages.size() > MAX_LOCAL_PAGES){
+            cache.pool->give_back(cache.pages, MAX_LOCAL_PAGES / 2);
+        }
+    }
+
+} // namespace pagepool
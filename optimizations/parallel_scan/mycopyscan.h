@@ -0,0 +1,72 @@
+#pragma once
+
+#include <common.h>
+#include <inner_column.h>
+
+#include <plan.h>
+#include <table.h>
+#include <value_t.h>
+#include <column_t.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace mycopyscan{
+
+    // input pages per scan task: a huge column is split across threads in chunks of this size
+    constexpr size_t SCAN_CHUNK_PAGES = 256;
+
+    struct ScanTask{
+        size_t column_idx;
+        size_t begin_page, end_page;
+    };
+
+    inline std::vector<columnt::column_t> copy_scan_value_t(const ColumnarTable& table,
+        const std::vector<std::tuple<size_t, DataType>>& output_attrs, uint8_t table_id){
+        std::vector<columnt::column_t> results;
+        results.resize(output_attrs.size());
+
+        // Nothing is copied: INT32 and VARCHAR columns are both referenced in place.
+        // Dense pages are read directly, sparse pages only get a rank index over their bitmap
+        // and string values are synthesized as NewString on access.
+        // The page range of every column is cut into chunks, so that one or two huge columns
+        // keep all threads busy: the first pass reads the page headers, the positions of every
+        // page are then summed up per column, and the second pass fills them in.
+        std::vector<columnt::RefPlan> plans(output_attrs.size());
+        std::vector<ScanTask> tasks;
+        for(size_t column_idx = 0; column_idx < output_attrs.size(); ++column_idx){
+            size_t in_col_idx = std::get<0>(output_attrs[column_idx]);
+            results[column_idx].start_reference(table, in_col_idx, table_id, plans[column_idx]);
+            const size_t num_pages = table.columns[in_col_idx].pages.size();
+            for(size_t begin = 0; begin < num_pages; begin += SCAN_CHUNK_PAGES){
+                tasks.push_back(ScanTask{column_idx, begin, std::min(begin + SCAN_CHUNK_PAGES, num_pages)});
+            }
+        }
+        if(tasks.empty()) return results;
+
+        auto plan_task = [&](size_t begin, size_t end) {
+            for(size_t task_idx = begin; task_idx < end; ++task_idx){
+                const ScanTask& task = tasks[task_idx];
+                results[task.column_idx].plan_reference_pages(plans[task.column_idx], task.begin_page, task.end_page);
+            }
+        };
+        filter_tp.run(plan_task, tasks.size());
+
+        std::vector<bool> fill(output_attrs.size());
+        for(size_t column_idx = 0; column_idx < output_attrs.size(); ++column_idx){
+            fill[column_idx] = results[column_idx].layout_reference(plans[column_idx]);
+        }
+        std::erase_if(tasks, [&](const ScanTask& task){ return !fill[task.column_idx]; });
+        if(tasks.empty()) return results;
+
+        auto fill_task = [&](size_t begin, size_t end) {
+            for(size_t task_idx = begin; task_idx < end; ++task_idx){
+                const ScanTask& task = tasks[task_idx];
+                results[task.column_idx].fill_reference_pages(plans[task.column_idx], task.begin_page, task.end_page);
+            }
+        };
+        filter_tp.run(fill_task, tasks.size());
+        return results;
+    }
+
+} // namespace mycopyscan
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+// Hardware performance counters per join phase.
+// Every thread taking part in a phase opens a perf_event_open group for itself
+// (cycles, instructions, LLC misses, dTLB load misses, branch misses), reads it
+// when it leaves the phase and adds the counts to the phase total.
+// When the kernel refuses the counters (containers, perf_event_paranoid, VMs
+// without a PMU) the first failure disables them for the whole process.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace perfcounters{
+
+    enum Event{ CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_EVENTS };
+
+    inline const char* event_name(size_t event){
+        static const char* names[NUM_EVENTS] = {"cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"};
+        return names[event];
+    }
+
+    struct Counts{
+        uint64_t values[NUM_EVENTS] = {};
+        bool present[NUM_EVENTS] = {}; // events the kernel accepted
+    };
+
+    // Sum of the counts of every thread that went through a phase
+    struct PhaseCounters{
+        std::mutex mutex;
+        Counts total;
+        size_t threads = 0;
+
+        void add(const Counts& counts){
+            std::lock_guard<std::mutex> lock(mutex);
+            for(size_t e = 0; e < NUM_EVENTS; ++e){
+                total.values[e] += counts.values[e];
+                total.present[e] |= counts.present[e];
+            }
+            ++threads;
+        }
+    };
+
+    inline std::atomic<bool> disabled{false};
+
+    inline void disable(const char* reason){
+        if(!disabled.exchange(true)){
+            fprintf(stderr, "perf counters disabled: %s\n", reason);
+        }
+    }
+
+    inline perf_event_attr make_attr(size_t event){
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        switch(event){
+            case CYCLES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case INSTRUCTIONS:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case LLC_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case DTLB_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            default:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+        }
+        return attr;
+    }
+
+    // Counter group of the calling thread
+    struct ThreadGroup{
+        int leader = -1;
+        int fds[NUM_EVENTS] = {-1, -1, -1, -1, -1};
+        size_t order[NUM_EVENTS] = {}; // event of every group member, in read order
+        size_t members = 0;
+
+        bool open(){
+            for(size_t e = 0; e < NUM_EVENTS; ++e){
+                perf_event_attr attr = make_attr(e);
+                attr.disabled = leader < 0 ? 1 : 0; // members follow the leader
+                int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if(fd < 0){
+                    if(leader < 0 && e == CYCLES){
+                        disable(strerror(errno)); // no cycles counter: nothing else will work either
+                        return false;
+                    }
+                    continue; // this event is not supported here, keep the others
+                }
+                if(leader < 0) leader = fd;
+                fds[e] = fd;
+                order[members++] = e;
+            }
+            return leader >= 0;
+        }
+
+        void start(){
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        bool stop(Counts& counts){
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            uint64_t buf[1 + NUM_EVENTS] = {};
+            ssize_t bytes = read(leader, buf, sizeof(buf));
+            if(bytes < static_cast<ssize_t>(sizeof(uint64_t)) || buf[0] != members) return false;
+            for(size_t i = 0; i < members; ++i){
+                counts.values[order[i]] = buf[1 + i];
+                counts.present[order[i]] = true;
+            }
+            return true;
+        }
+
+        ~ThreadGroup(){
+            for(int fd : fds){
+                if(fd >= 0) close(fd);
+            }
+        }
+    };
+
+    // Counts the calling thread from construction to destruction into target (nothing when null)
+    struct ThreadScope{
+        PhaseCounters* target = nullptr;
+        ThreadGroup group;
+
+        explicit ThreadScope(PhaseCounters* phase){
+            if(!phase || disabled.load(std::memory_order_relaxed)) return;
+            if(!group.open()) return;
+            target = phase;
+            group.start();
+        }
+
+        ~ThreadScope(){
+            if(!target) return;
+            Counts counts;
+            if(group.stop(counts)) target->add(counts);
+        }
+
+        ThreadScope(const ThreadScope&) = delete;
+        ThreadScope& operator=(const ThreadScope&) = delete;
+    };
+
+} // namespace perfcounters
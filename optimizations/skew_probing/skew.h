@@ -0,0 +1,80 @@
+#pragma once
+// Skew-aware probing.
+// A probe key whose match range is longer than heavy_range_entries() is not emitted
+// by the worker whose probe page contains it: the worker records the range and moves
+// on to its next page. Once the pages are done, the recorded ranges are cut into
+// slices of heavy_range_entries() and every probe thread pulls slices from a shared
+// counter, so a key matching millions of build rows is emitted by all threads.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <perf_counters.h>
+
+namespace skew{
+
+    // match range of one probe row (or a slice of it)
+    template <typename Entry>
+    struct HeavyRange{
+        size_t probe_idx;
+        int32_t key;
+        const Entry* entries;
+        size_t len;
+    };
+
+    // SPC_HEAVY_RANGE overrides the split threshold, in hash entries
+    inline size_t heavy_range_entries(){
+        static const size_t entries = [] {
+            size_t value = 8192;
+            if(const char* v = std::getenv("SPC_HEAVY_RANGE")){
+                char* end = nullptr;
+                const unsigned long parsed = std::strtoul(v, &end, 10);
+                if(end != v && parsed > 0) value = parsed;
+            }
+            return value;
+        }();
+        return entries;
+    }
+
+    // Cuts the ranges every thread recorded into slices of at most slice_len entries
+    template <typename Entry>
+    std::vector<HeavyRange<Entry>> split(const std::vector<std::vector<HeavyRange<Entry>>>& recorded, size_t slice_len){
+        std::vector<HeavyRange<Entry>> slices;
+        for(const auto& ranges : recorded){
+            for(const auto& range : ranges){
+                for(size_t begin = 0; begin < range.len; begin += slice_len){
+                    slices.push_back({range.probe_idx, range.key, range.entries + begin, std::min(slice_len, range.len - begin)});
+                }
+            }
+        }
+        return slices;
+    }
+
+    // Calls fn(thread, slice) for every slice on up to threads workers, slices handed out one at a time
+    template <typename Entry, typename Fn>
+    void run_slices(const std::vector<HeavyRange<Entry>>& slices, size_t threads, perfcounters::PhaseCounters* phase_counters, Fn&& fn){
+        if(slices.empty()) return;
+        threads = std::max<size_t>(1, std::min(threads, slices.size()));
+
+        std::atomic<size_t> next_slice{0};
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for(size_t t = 0; t < threads; ++t){
+            workers.emplace_back([&, t]() {
+                perfcounters::ThreadScope counters(phase_counters);
+                while(true){
+                    const size_t slice = next_slice.fetch_add(1, std::memory_order_relaxed);
+                    if(slice >= slices.size()) break;
+                    fn(t, slices[slice]);
+                }
+            });
+        }
+        for(auto& w : workers) w.join();
+    }
+
+} // namespace skew
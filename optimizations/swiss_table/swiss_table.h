@@ -0,0 +1,161 @@
+#pragma once
+// Swiss table join engine: open addressing over groups of 16 slots. Every slot has a control
+// byte holding 7 bits of the key hash (0x80 while empty), so one SSE2 compare + movemask
+// over a group finds the candidate slots, and a lookup usually touches one control group
+// and one slot. Groups are probed quadratically (triangular numbers over the groups).
+// Slots are plain 8 byte entries: a key with a single build row keeps it in its slot and
+// find_range returns the slot itself. Keys with duplicates point their slot into the side
+// chain: a header entry holding their count, followed by their entries.
+// Built in bulk with at most 7/8 of the slots in use (sized from the build rows, no growth).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+
+#include <unchained_table.h>
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct SwissTable{
+        static constexpr size_t GROUP = 16;
+        static constexpr uint8_t EMPTY = 0x80;
+        static constexpr uint32_t DUPLICATES = 1u << 31; // slot row_idx: header position in chain (build rows stay below 2^31)
+
+        std::unique_ptr<uint8_t[]> ctrl_storage;
+        uint8_t* ctrl = nullptr;            // 16 byte aligned control bytes
+        std::vector<HashEntry> slots;
+        std::vector<HashEntry> chain;       // keys with duplicates: header {key, count}, then their entries
+        size_t group_mask = 0;
+        unsigned group_bits = 0;
+        size_t num_elements = 0;
+
+        void reserve(size_t build_size){
+            size_t groups = 1;
+            while(groups * GROUP * 7 / 8 < build_size) groups <<= 1;
+            group_mask = groups - 1;
+            group_bits = static_cast<unsigned>(__builtin_ctzll(groups));
+
+            ctrl_storage.reset(new uint8_t[groups * GROUP + GROUP]);
+            ctrl = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(ctrl_storage.get()) + GROUP - 1) & ~uintptr_t{GROUP - 1});
+            std::memset(ctrl, EMPTY, groups * GROUP);
+            slots.assign(groups * GROUP, HashEntry{});
+        }
+
+        static uint64_t hash(int32_t key){
+            return UnchainedHashTable::hash(key);
+        }
+
+        static uint8_t fingerprint(uint64_t h){
+            return static_cast<uint8_t>(h >> 57);
+        }
+
+        size_t home_group(uint64_t h) const{
+            return (h >> (57 - group_bits)) & group_mask;
+        }
+
+        // Bit i set: control byte i of the group equals byte
+        static uint32_t match(const uint8_t* group, uint8_t byte){
+#if defined(__x86_64__) || defined(__i386__)
+            const __m128i ctrl_bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_bytes, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+            uint32_t mask = 0;
+            for(size_t i = 0; i < GROUP; ++i) mask |= static_cast<uint32_t>(group[i] == byte) << i;
+            return mask;
+#endif
+        }
+
+        // Slot of key, or NO_SLOT with *free_slot (when given) set to the first empty slot of its probe sequence
+        size_t find_slot(int32_t key, size_t* free_slot = nullptr) const{
+            const uint64_t h = hash(key);
+            const uint8_t print = fingerprint(h);
+            size_t group = home_group(h);
+            for(size_t step = 1;; ++step){
+                const uint8_t* group_ctrl = ctrl + group * GROUP;
+                for(uint32_t bits = match(group_ctrl, print); bits; bits &= bits - 1){
+                    const size_t slot = group * GROUP + __builtin_ctz(bits);
+                    if(slots[slot].key == key) return slot;
+                }
+                if(const uint32_t empty = match(group_ctrl, EMPTY)){
+                    if(free_slot) *free_slot = group * GROUP + __builtin_ctz(empty);
+                    return NO_SLOT;
+                }
+                group = (group + step) & group_mask;
+            }
+        }
+
+        // Pass 1 places the first row of every key in its slot and counts the others.
+        // Pass 2 (only when there are duplicates) fills the side chain.
+        template <typename EntryAt>
+        void build_parallel(size_t count, [[maybe_unused]] size_t threads, EntryAt&& entry_at){
+            std::vector<uint32_t> counts(slots.size(), 0);
+            HashEntry entry;
+            num_elements = 0;
+            size_t chain_size = 0;
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                ++num_elements;
+                size_t free_slot = NO_SLOT;
+                const size_t slot = find_slot(entry.key, &free_slot);
+                if(slot != NO_SLOT){
+                    chain_size += counts[slot]++ == 1 ? 3 : 1; // header and first row come with the second row
+                    continue;
+                }
+                ctrl[free_slot] = fingerprint(hash(entry.key));
+                slots[free_slot] = entry;
+                counts[free_slot] = 1;
+            }
+            if(chain_size == 0) return;
+
+            // headers count up again while the entries are copied
+            chain.clear();
+            chain.reserve(chain_size);
+            for(size_t slot = 0; slot < slots.size(); ++slot){
+                if(counts[slot] < 2) continue;
+                const uint32_t header = static_cast<uint32_t>(chain.size());
+                chain.resize(chain.size() + 1 + counts[slot]);
+                chain[header] = HashEntry(slots[slot].key, 0);
+                slots[slot].row_idx = DUPLICATES | header;
+            }
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                const HashEntry& slot = slots[find_slot(entry.key)];
+                if(!(slot.row_idx & DUPLICATES)) continue;
+                HashEntry& header = chain[slot.row_idx & ~DUPLICATES];
+                (&header)[1 + header.row_idx++] = entry;
+            }
+        }
+
+        const HashEntry* find_range(int32_t key, size_t& len) const{
+            const size_t slot = find_slot(key);
+            if(slot == NO_SLOT){
+                len = 0;
+                return nullptr;
+            }
+            const HashEntry& entry = slots[slot];
+            if(!(entry.row_idx & DUPLICATES)){
+                len = 1;
+                return &entry;
+            }
+            const HashEntry* header = chain.data() + (entry.row_idx & ~DUPLICATES);
+            len = header->row_idx;
+            return header + 1;
+        }
+
+        size_t size() const{
+            return num_elements;
+        }
+
+        size_t bytes() const{
+            return slots.size() * (sizeof(HashEntry) + 1) + chain.capacity() * sizeof(HashEntry);
+        }
+    };
+
+} // namespace jointable
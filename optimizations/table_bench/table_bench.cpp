@@ -0,0 +1,644 @@
+// Hash table microbenchmark: every table engine of the repo on the same workloads.
+// Reports build and probe throughput, memory per build tuple and cache misses.
+//
+// build (from optimizations/table_bench):
+//   g++ -std=c++20 -O3 -march=native -pthread
+//       -I../robinhood -I../cuckoo -I../hopscotch -I../swiss_table -I../bucket_cuckoo
+//       -I../flat_robinhood -I../bitmap_hopscotch -I../table_engines -I../build_payload
+//       -I../compact_entries -I../building_parallelization
+//       table_bench.cpp ../building_parallelization/threaded_table.cpp -o table_bench
+//
+// usage: ./table_bench [--engines=robinhood,cuckoo,hopscotch,unchained,threaded,swiss,bucket_cuckoo,
+//                                 flat_robinhood,hopscotch16,hopscotch32,hopscotch64]
+//                      [--workloads=unique,dup,zipf,tail] [--dup=8] [--zipf=0.99]
+//                      [--max-tuples=N] [--threads=N] [--repeat=N] [--seed=N] [--csv]
+//
+// Sizes go from the L1 cache to 10x the last level cache (in 8 byte build tuples, one HashEntry),
+// probes run single threaded with hit rates 0, 25, 50, 75 and 100%.
+// The tail workload (not run by default) adds 64 keys hashed into the top 64 / tuples of the
+// range to distinct keys: engines that map hashes to slots by multiply-shift crowd them into
+// the last neighborhoods of the table and the padding after them.
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// the three open addressing tables all define a global Hashalgorithm
+namespace robinhood_table{
+#include <robinhood.h>
+}
+namespace cuckoo_table{
+#include <cuckoo.h>
+}
+namespace hopscotch_table{
+#include <hopscotch.h>
+}
+
+#include <threaded_table.h>
+#include <unchained_table.h>
+#include <swiss_table.h>
+#include <bucket_cuckoo_table.h>
+#include <flat_robinhood_table.h>
+#include <bitmap_hopscotch_table.h>
+
+namespace tablebench{
+
+    // ---------------------------------------------------------------- measurement
+
+    // Hardware cache misses of this thread and the threads it starts (-1 => unavailable)
+    struct CacheMissCounter{
+        int fd = -1;
+
+        CacheMissCounter(){
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        ~CacheMissCounter(){
+            if(fd >= 0) close(fd);
+        }
+
+        CacheMissCounter(const CacheMissCounter&) = delete;
+        CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+        void start(){
+            if(fd < 0) return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        int64_t stop(){
+            if(fd < 0) return -1;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t count = 0;
+            if(read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+            return static_cast<int64_t>(count);
+        }
+    };
+
+    struct PhaseResult{
+        double seconds = 0;
+        int64_t cache_misses = -1;
+    };
+
+    template <typename Fn>
+    PhaseResult measure(Fn&& fn){
+        CacheMissCounter counter;
+        auto begin = std::chrono::steady_clock::now();
+        counter.start();
+        fn();
+        int64_t misses = counter.stop();
+        auto end = std::chrono::steady_clock::now();
+        return PhaseResult{std::chrono::duration<double>(end - begin).count(), misses};
+    }
+
+    // ---------------------------------------------------------------- workloads
+
+    // Distinct keys: a bijection of the index, so keys at index >= num_distinct never hit
+    inline int32_t key_of(uint64_t idx){
+        return static_cast<int32_t>(static_cast<uint32_t>(idx) * 0x9E3779B1u ^ 0x5bd1e995u);
+    }
+
+    struct Workload{
+        std::string name;
+        std::vector<int32_t> build_keys;
+        size_t num_distinct = 0;
+    };
+
+    // Zipf distributed ranks in [0, n) through the inverse of the cumulative distribution
+    struct ZipfSampler{
+        std::vector<double> cdf;
+
+        ZipfSampler(size_t n, double theta) : cdf(n){
+            double sum = 0;
+            for(size_t i = 0; i < n; ++i){
+                sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+                cdf[i] = sum;
+            }
+            for(auto& c : cdf) c /= sum;
+        }
+
+        template <typename Rng>
+        size_t operator()(Rng& rng){
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            size_t rank = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            return std::min(rank, cdf.size() - 1);
+        }
+    };
+
+    inline Workload make_workload(const std::string& kind, size_t num_tuples, size_t dup, double theta, std::mt19937_64& rng){
+        Workload workload;
+        workload.build_keys.resize(num_tuples);
+
+        if(kind == "unique"){
+            workload.name = "unique";
+            workload.num_distinct = num_tuples;
+            for(size_t i = 0; i < num_tuples; ++i) workload.build_keys[i] = key_of(i);
+            std::shuffle(workload.build_keys.begin(), workload.build_keys.end(), rng);
+        }
+        else if(kind == "dup"){
+            workload.name = "dup" + std::to_string(dup);
+            workload.num_distinct = std::max<size_t>(1, num_tuples / dup);
+            std::uniform_int_distribution<size_t> pick(0, workload.num_distinct - 1);
+            for(auto& key : workload.build_keys) key = key_of(pick(rng));
+        }
+        else if(kind == "tail"){
+            // distinct keys, the last TAIL_KEYS with hashes in the top 64 / num_tuples of the range
+            constexpr size_t TAIL_KEYS = 64;
+            workload.name = "tail";
+            const size_t tail = std::min(TAIL_KEYS, num_tuples / 4);
+            const uint64_t tail_from = (uint64_t{1} << 32) - std::min<uint64_t>(uint64_t{1} << 32, (uint64_t{64} << 32) / num_tuples);
+            size_t idx = 0;
+            for(size_t i = 0; i < num_tuples; ++i){
+                if(i >= num_tuples - tail){
+                    while(jointable::mix32(key_of(idx)) < tail_from) ++idx;
+                }
+                workload.build_keys[i] = key_of(idx++);
+            }
+            workload.num_distinct = idx; // misses start past the last index scanned
+            std::shuffle(workload.build_keys.begin(), workload.build_keys.end(), rng);
+        }
+        else if(kind == "zipf"){
+            char name[32];
+            snprintf(name, sizeof(name), "zipf%.2f", theta);
+            workload.name = name;
+            workload.num_distinct = num_tuples;
+            ZipfSampler sample(num_tuples, theta);
+            for(auto& key : workload.build_keys) key = key_of(sample(rng));
+        }
+        else{
+            fprintf(stderr, "unknown workload %s\n", kind.c_str());
+            exit(1);
+        }
+        return workload;
+    }
+
+    // Probe keys with the given share of hits, hits follow the build key distribution
+    inline std::vector<int32_t> make_probe_keys(const Workload& workload, size_t num_probes, double hit_rate, std::mt19937_64& rng){
+        std::vector<int32_t> keys(num_probes);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::uniform_int_distribution<size_t> pick_build(0, workload.build_keys.size() - 1);
+        std::uniform_int_distribution<size_t> pick_miss(0, workload.num_distinct);
+        for(auto& key : keys){
+            if(coin(rng) < hit_rate) key = workload.build_keys[pick_build(rng)];
+            else key = key_of(workload.num_distinct + pick_miss(rng));
+        }
+        return keys;
+    }
+
+    // ---------------------------------------------------------------- engines
+    // build(keys): row index = position in keys
+    // probe(keys): number of (build, probe) matches
+    // bytes(): memory held by the built table
+
+    template <typename Table>
+    struct OpenAddressingEngine{
+        std::unique_ptr<Table> table;
+
+        void build(const std::vector<int32_t>& keys){
+            table = std::make_unique<Table>(keys.size());
+            for(size_t row_idx = 0; row_idx < keys.size(); ++row_idx){
+                table->insert(keys[row_idx], {row_idx});
+            }
+        }
+
+        size_t probe(const std::vector<int32_t>& keys) const{
+            size_t matches = 0;
+            for(int32_t key : keys){
+                matches += table->find_values(key).size();
+            }
+            return matches;
+        }
+
+        template <typename Entries>
+        static size_t entries_bytes(const Entries& entries){
+            size_t bytes = entries.capacity() * sizeof(typename Entries::value_type);
+            for(const auto& entry : entries){
+                bytes += entry.values.capacity() * sizeof(size_t);
+            }
+            return bytes;
+        }
+    };
+
+    struct RobinhoodEngine : OpenAddressingEngine<robinhood_table::Hashalgorithm<int32_t>>{
+        static constexpr const char* name = "robinhood";
+        size_t bytes() const{ return entries_bytes(table->hashtable); }
+    };
+
+    struct CuckooEngine : OpenAddressingEngine<cuckoo_table::Hashalgorithm<int32_t>>{
+        static constexpr const char* name = "cuckoo";
+        size_t bytes() const{ return entries_bytes(table->hashtable1) + entries_bytes(table->hashtable2); }
+    };
+
+    struct HopscotchEngine : OpenAddressingEngine<hopscotch_table::Hashalgorithm<int32_t>>{
+        static constexpr const char* name = "hopscotch";
+        size_t bytes() const{ return entries_bytes(table->hashtable); }
+    };
+
+    template <typename Table>
+    size_t probe_ranges(const Table& table, const std::vector<int32_t>& keys){
+        size_t matches = 0;
+        for(int32_t key : keys){
+            size_t len = 0;
+            const auto* entries = table.find_range(key, len);
+            if(!entries || len == 0) continue;
+            for(size_t i = 0; i < len; ++i){
+                matches += (entries[i].key == key);
+            }
+        }
+        return matches;
+    }
+
+    struct UnchainedEngine{
+        static constexpr const char* name = "unchained";
+        std::unique_ptr<::UnchainedHashTable> table;
+
+        void build(const std::vector<int32_t>& keys){
+            table = std::make_unique<::UnchainedHashTable>();
+            table->reserve(keys.size());
+            for(size_t row_idx = 0; row_idx < keys.size(); ++row_idx){
+                table->insert(keys[row_idx], row_idx);
+            }
+            table->finalize();
+        }
+
+        size_t probe(const std::vector<int32_t>& keys) const{ return probe_ranges(*table, keys); }
+
+        size_t bytes() const{
+            // temp_entries keeps its capacity after finalize
+            return (table->num_elements + table->temp_entries.capacity()) * sizeof(::HashEntry) +
+                   (table->capacity + 1) * sizeof(uint64_t);
+        }
+    };
+
+    // Engines of join_table.h, built in bulk from the key column like the columnar join does
+    template <typename Table>
+    struct JoinTableEngine{
+        std::unique_ptr<Table> table;
+
+        void build(const std::vector<int32_t>& keys){
+            table = std::make_unique<Table>();
+            table->reserve(keys.size());
+            table->build_parallel(keys.size(), 1, [&](size_t row_idx, ::HashEntry& entry){
+                entry = ::HashEntry(keys[row_idx], row_idx);
+                return true;
+            });
+        }
+
+        size_t probe(const std::vector<int32_t>& keys) const{ return probe_ranges(*table, keys); }
+
+        size_t bytes() const{ return table->bytes(); }
+    };
+
+    struct SwissEngine : JoinTableEngine<jointable::SwissTable>{
+        static constexpr const char* name = "swiss";
+    };
+
+    struct BucketCuckooEngine : JoinTableEngine<jointable::BucketCuckooTable>{
+        static constexpr const char* name = "bucket_cuckoo";
+    };
+
+    // Engines with a batched find_ranges probe through it
+    template <typename Table>
+    struct BatchedJoinTableEngine : JoinTableEngine<Table>{
+        size_t probe(const std::vector<int32_t>& keys) const{
+            constexpr size_t BATCH = 1024;
+            const ::HashEntry* ranges[BATCH];
+            size_t lens[BATCH];
+            size_t matches = 0;
+            for(size_t begin = 0; begin < keys.size(); begin += BATCH){
+                const size_t n = std::min(BATCH, keys.size() - begin);
+                this->table->find_ranges(keys.data() + begin, n, ranges, lens);
+                for(size_t i = 0; i < n; ++i){
+                    for(size_t j = 0; j < lens[i]; ++j) matches += (ranges[i][j].key == keys[begin + i]);
+                }
+            }
+            return matches;
+        }
+    };
+
+    struct FlatRobinHoodEngine : BatchedJoinTableEngine<jointable::FlatRobinHoodTable>{
+        static constexpr const char* name = "flat_robinhood";
+    };
+
+    struct Hopscotch16Engine : BatchedJoinTableEngine<jointable::BitmapHopscotchTable<16>>{
+        static constexpr const char* name = "hopscotch16";
+    };
+
+    struct Hopscotch32Engine : BatchedJoinTableEngine<jointable::BitmapHopscotchTable<32>>{
+        static constexpr const char* name = "hopscotch32";
+    };
+
+    struct Hopscotch64Engine : BatchedJoinTableEngine<jointable::BitmapHopscotchTable<64>>{
+        static constexpr const char* name = "hopscotch64";
+    };
+
+    // Same three phases as the threaded build of execute.cpp
+    struct ThreadedEngine{
+        static constexpr const char* name = "threaded";
+        size_t num_threads = 1;
+        std::unique_ptr<threaded::GlobalAllocator> global_alloc;
+        std::vector<std::unique_ptr<threaded::TupleCollector>> collectors;
+        std::unique_ptr<threaded::FinalTable> table;
+
+        void build(const std::vector<int32_t>& keys){
+            size_t num_partitions = 1;
+            while(num_partitions < num_threads) num_partitions *= 2;
+
+            global_alloc = std::make_unique<threaded::GlobalAllocator>();
+            collectors.clear();
+            for(size_t t = 0; t < num_partitions; ++t){
+                collectors.push_back(std::make_unique<threaded::TupleCollector>(*global_alloc, num_partitions));
+            }
+
+            // Phase 1: Collect
+            std::vector<std::thread> threads;
+            const size_t rows_per_thread = (keys.size() + num_partitions - 1) / num_partitions;
+            for(size_t t = 0; t < num_partitions; ++t){
+                threads.emplace_back([&, t](){
+                    const size_t start = std::min(t * rows_per_thread, keys.size());
+                    const size_t end = std::min(start + rows_per_thread, keys.size());
+                    for(size_t row_idx = start; row_idx < end; ++row_idx){
+                        collectors[t]->consume(threaded::HashEntry(keys[row_idx], row_idx));
+                    }
+                });
+            }
+            for(auto& t : threads) t.join();
+            threads.clear();
+
+            // Phase 2: Count and Copy
+            std::vector<threaded::Block*> partition_heads = threaded::merge_partitions(collectors, num_partitions);
+            std::vector<size_t> partition_offsets(num_partitions, 0);
+            size_t total_tuples = 0;
+            for(size_t p = 0; p < num_partitions; ++p){
+                partition_offsets[p] = total_tuples;
+                for(const auto& collector : collectors) total_tuples += collector->counts[p];
+            }
+
+            table = std::make_unique<threaded::FinalTable>(total_tuples, num_partitions);
+            for(size_t p = 0; p < num_partitions; ++p){
+                threads.emplace_back([&, p](){
+                    table->postProcessBuild(p, partition_offsets[p], partition_heads);
+                });
+            }
+            for(auto& t : threads) t.join();
+        }
+
+        size_t probe(const std::vector<int32_t>& keys) const{ return probe_ranges(*table, keys); }
+
+        size_t bytes() const{
+            // collected chunks stay alive until the join is done
+            size_t large_chunks = 0;
+            for(const auto& collector : collectors){
+                for(auto* block = collector->level2.head; block; block = block->next) ++large_chunks;
+            }
+            const size_t capacity = 1ull << (64 - table->shift);
+            return large_chunks * threaded::GlobalAllocator::LARGE_CHUNK_SIZE +
+                   table->num_elements * sizeof(threaded::HashEntry) + (capacity + 1) * sizeof(uint64_t);
+        }
+    };
+
+    // ---------------------------------------------------------------- driver
+
+    struct Options{
+        std::vector<std::string> engines = {"robinhood", "cuckoo", "hopscotch", "unchained", "threaded", "swiss", "bucket_cuckoo",
+                                             "flat_robinhood", "hopscotch16", "hopscotch32", "hopscotch64"};
+        std::vector<std::string> workloads = {"unique", "dup", "zipf"};
+        size_t dup = 8;
+        double theta = 0.99;
+        size_t max_tuples = 0; // 0 => 10x LLC
+        size_t threads = 0;    // 0 => hardware concurrency
+        size_t repeat = 1;
+        uint64_t seed = 42;
+        bool csv = false;
+    };
+
+    inline std::vector<std::string> split(const std::string& s){
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while(start <= s.size()){
+            size_t end = s.find(',', start);
+            if(end == std::string::npos) end = s.size();
+            if(end > start) parts.push_back(s.substr(start, end - start));
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    inline Options parse_options(int argc, char** argv){
+        Options options;
+        for(int i = 1; i < argc; ++i){
+            std::string arg = argv[i];
+            auto value = [&](const char* flag) -> const char* {
+                size_t len = strlen(flag);
+                return arg.compare(0, len, flag) == 0 ? arg.c_str() + len : nullptr;
+            };
+            if(const char* v = value("--engines=")) options.engines = split(v);
+            else if(const char* v = value("--workloads=")) options.workloads = split(v);
+            else if(const char* v = value("--dup=")) options.dup = std::max<size_t>(1, strtoull(v, nullptr, 10));
+            else if(const char* v = value("--zipf=")) options.theta = strtod(v, nullptr);
+            else if(const char* v = value("--max-tuples=")) options.max_tuples = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--threads=")) options.threads = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--repeat=")) options.repeat = std::max<size_t>(1, strtoull(v, nullptr, 10));
+            else if(const char* v = value("--seed=")) options.seed = strtoull(v, nullptr, 10);
+            else if(arg == "--csv") options.csv = true;
+            else{
+                fprintf(stderr, "unknown option %s\n", arg.c_str());
+                exit(1);
+            }
+        }
+        return options;
+    }
+
+    inline size_t cache_size(int name, size_t fallback){
+        long size = sysconf(name);
+        return size > 0 ? static_cast<size_t>(size) : fallback;
+    }
+
+    // Build sizes (in tuples) spanning the cache hierarchy
+    inline std::vector<std::pair<std::string, size_t>> build_sizes(size_t max_tuples){
+        constexpr size_t TUPLE_BYTES = sizeof(::HashEntry); // key + row index
+        static_assert(sizeof(threaded::HashEntry) == TUPLE_BYTES);
+        const size_t l1 = cache_size(_SC_LEVEL1_DCACHE_SIZE, 32u << 10);
+        const size_t l2 = cache_size(_SC_LEVEL2_CACHE_SIZE, 1u << 20);
+        const size_t llc = cache_size(_SC_LEVEL3_CACHE_SIZE, 32u << 20);
+
+        std::vector<std::pair<std::string, size_t>> sizes = {
+            {"L1", l1 / TUPLE_BYTES}, {"L2", l2 / TUPLE_BYTES}, {"LLC/2", llc / 2 / TUPLE_BYTES},
+            {"2xLLC", 2 * llc / TUPLE_BYTES}, {"10xLLC", 10 * llc / TUPLE_BYTES}};
+        for(auto& [label, tuples] : sizes){
+            if(max_tuples && tuples > max_tuples) tuples = max_tuples;
+        }
+        // clamping may leave duplicates at the top
+        sizes.erase(std::unique(sizes.begin(), sizes.end(),
+            [](const auto& a, const auto& b){ return a.second == b.second; }), sizes.end());
+        return sizes;
+    }
+
+    inline void print_header(bool csv){
+        if(csv){
+            printf("engine,workload,size,tuples,bytes_per_tuple,build_mtps,build_misses_per_tuple,hit_rate,probe_mtps,probe_misses_per_tuple,matches\n");
+            return;
+        }
+        printf("%-14s %-10s %-7s %10s %8s %9s %9s %5s %9s %9s %12s\n",
+            "engine", "workload", "size", "tuples", "B/tuple", "build M/s", "miss/tup", "hit%", "probe M/s", "miss/tup", "matches");
+    }
+
+    inline double per_tuple(int64_t misses, size_t tuples){
+        return misses < 0 ? -1.0 : static_cast<double>(misses) / static_cast<double>(tuples);
+    }
+
+    template <typename Engine>
+    void run_engine(Engine& engine, const Workload& workload, const std::string& size_label,
+                    const std::vector<std::vector<int32_t>>& probes, const std::vector<double>& hit_rates,
+                    std::vector<size_t>& expected_matches, const Options& options){
+        const size_t num_tuples = workload.build_keys.size();
+
+        PhaseResult build{};
+        for(size_t r = 0; r < options.repeat; ++r){
+            PhaseResult run = measure([&]{ engine.build(workload.build_keys); });
+            if(r == 0 || run.seconds < build.seconds) build = run;
+        }
+        const double bytes_per_tuple = static_cast<double>(engine.bytes()) / static_cast<double>(num_tuples);
+
+        for(size_t h = 0; h < hit_rates.size(); ++h){
+            PhaseResult probe{};
+            size_t matches = 0;
+            for(size_t r = 0; r < options.repeat; ++r){
+                PhaseResult run = measure([&]{ matches = engine.probe(probes[h]); });
+                if(r == 0 || run.seconds < probe.seconds) probe = run;
+            }
+
+            // every engine must agree with the first one
+            if(expected_matches[h] == SIZE_MAX) expected_matches[h] = matches;
+            else if(expected_matches[h] != matches){
+                fprintf(stderr, "%s: %zu matches on %s/%s at %.0f%% hits, expected %zu\n", Engine::name, matches,
+                    workload.name.c_str(), size_label.c_str(), hit_rates[h] * 100, expected_matches[h]);
+                exit(1);
+            }
+
+            const double build_mtps = static_cast<double>(num_tuples) / build.seconds / 1e6;
+            const double probe_mtps = static_cast<double>(probes[h].size()) / probe.seconds / 1e6;
+            const double build_misses = per_tuple(build.cache_misses, num_tuples);
+            const double probe_misses = per_tuple(probe.cache_misses, probes[h].size());
+            if(options.csv){
+                printf("%s,%s,%s,%zu,%.2f,%.2f,%.3f,%.2f,%.2f,%.3f,%zu\n", Engine::name, workload.name.c_str(), size_label.c_str(),
+                    num_tuples, bytes_per_tuple, build_mtps, build_misses, hit_rates[h], probe_mtps, probe_misses, matches);
+            }
+            else{
+                printf("%-14s %-10s %-7s %10zu %8.2f %9.2f %9.3f %5.0f %9.2f %9.3f %12zu\n", Engine::name, workload.name.c_str(),
+                    size_label.c_str(), num_tuples, bytes_per_tuple, build_mtps, build_misses, hit_rates[h] * 100,
+                    probe_mtps, probe_misses, matches);
+            }
+            fflush(stdout);
+        }
+    }
+
+} // namespace tablebench
+
+int main(int argc, char** argv){
+    using namespace tablebench;
+    Options options = parse_options(argc, argv);
+    if(options.threads == 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::vector<double> hit_rates = {0.0, 0.25, 0.5, 0.75, 1.0};
+    size_t max_tuples = options.max_tuples;
+
+    if(CacheMissCounter().fd < 0){
+        fprintf(stderr, "perf_event_open unavailable: cache misses are reported as -1\n");
+    }
+    print_header(options.csv);
+
+    std::mt19937_64 rng(options.seed);
+    for(const auto& [size_label, num_tuples] : build_sizes(max_tuples)){
+        for(const auto& kind : options.workloads){
+            Workload workload = make_workload(kind, num_tuples, options.dup, options.theta, rng);
+
+            std::vector<std::vector<int32_t>> probes;
+            for(double hit_rate : hit_rates){
+                probes.push_back(make_probe_keys(workload, num_tuples, hit_rate, rng));
+            }
+
+            std::vector<size_t> expected_matches(hit_rates.size(), SIZE_MAX);
+            for(const auto& engine_name : options.engines){
+                if(engine_name == "robinhood"){
+                    RobinhoodEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "cuckoo"){
+                    CuckooEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "hopscotch"){
+                    HopscotchEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "unchained"){
+                    UnchainedEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "threaded"){
+                    ThreadedEngine engine;
+                    engine.num_threads = options.threads;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "swiss"){
+                    SwissEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "bucket_cuckoo"){
+                    BucketCuckooEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "flat_robinhood"){
+                    FlatRobinHoodEngine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "hopscotch16"){
+                    Hopscotch16Engine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "hopscotch32"){
+                    Hopscotch32Engine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else if(engine_name == "hopscotch64"){
+                    Hopscotch64Engine engine;
+                    run_engine(engine, workload, size_label, probes, hit_rates, expected_matches, options);
+                }
+                else{
+                    fprintf(stderr, "unknown engine %s\n", engine_name.c_str());
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
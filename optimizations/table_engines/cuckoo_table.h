@@ -0,0 +1,92 @@
+#pragma once
+// Cuckoo join table: every key lives in one of two slots, one per hash function and
+// sub-table, so a lookup reads at most two slots. An insert evicts the occupant of its
+// slot and reinserts it into its other sub-table; long eviction chains double the table.
+// Columnar port of cuckoo/cuckoo.h, entries grouped by key (see grouped_table.h).
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct CuckooTable : GroupedTable<CuckooTable>{
+        struct Slot : KeySlot{
+            bool occupied = false;
+        };
+
+        std::vector<Slot> slots; // sub-table 1 in [0, half), sub-table 2 in [half, 2 * half)
+        size_t half = 0;
+        unsigned bits = 0;
+
+        static bool occupied(const Slot& slot){
+            return slot.occupied;
+        }
+
+        void reserve(size_t build_size){
+            half = std::max<size_t>(16, next_pow2(build_size) * 2);
+            bits = static_cast<unsigned>(__builtin_ctzll(half));
+            slots.assign(2 * half, Slot{});
+        }
+
+        size_t position1(int32_t key) const{
+            return mix32(key) & (half - 1);
+        }
+
+        // Fibonacci hashing on the high bits, independent of position1
+        size_t position2(int32_t key) const{
+            return half + static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(key)) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        }
+
+        size_t find_slot(int32_t key) const{
+            const size_t pos1 = position1(key);
+            if(slots[pos1].occupied && slots[pos1].key == key) return pos1;
+            const size_t pos2 = position2(key);
+            if(slots[pos2].occupied && slots[pos2].key == key) return pos2;
+            return NO_SLOT;
+        }
+
+        size_t upsert(int32_t key){
+            if(const size_t found = find_slot(key); found != NO_SLOT) return found;
+
+            Slot current;
+            current.key = key;
+            current.occupied = true;
+            place(current);
+            return find_slot(key);
+        }
+
+    private:
+        void place(Slot current){
+            const size_t max_kicks = 4 * bits;
+            bool first = true;
+            for(size_t kicks = 0; kicks <= max_kicks; ++kicks){
+                const size_t pos = first ? position1(current.key) : position2(current.key);
+                if(!slots[pos].occupied){
+                    slots[pos] = current;
+                    return;
+                }
+                std::swap(slots[pos], current);
+                first = !first;
+            }
+            grow();
+            place(current);
+        }
+
+        // Doubles both sub-tables and reinserts every key with its counts
+        void grow(){
+            std::vector<Slot> old = std::move(slots);
+            half *= 2;
+            bits++;
+            slots.assign(2 * half, Slot{});
+            for(const auto& slot : old){
+                if(slot.occupied) place(slot);
+            }
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,97 @@
+#pragma once
+// Shared build and probe of the open addressing join tables (robinhood, cuckoo, hopscotch).
+// The tables map every distinct key to one slot. The build entries of a key sit next to
+// each other in one array (begin, count in the slot), so find_range hands out all matches
+// of a key at once like the unchained table does.
+// Build in two passes over the input: count the entries of every key (inserting new keys),
+// then turn the counts into offsets and scatter the entries. Keys move between slots only
+// while inserting, so slot positions are stable during the scatter.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <unchained_table.h>
+
+namespace jointable{
+
+    constexpr size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+    // Distinct key and where its entries are; the tables extend it with their own metadata
+    struct KeySlot{
+        int32_t key = 0;
+        uint32_t begin = 0;
+        uint32_t count = 0;
+    };
+
+    // Fills the tables from the murmur3 finalizer on the key
+    inline uint32_t mix32(int32_t key){
+        uint32_t x = static_cast<uint32_t>(key);
+        x ^= x >> 16;
+        x *= 0x85ebca6b;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35;
+        x ^= x >> 16;
+        return x;
+    }
+
+    inline size_t next_pow2(size_t n){
+        size_t p = 1;
+        while(p < n) p <<= 1;
+        return p;
+    }
+
+    // Derived provides: slots (vector of KeySlot extensions), occupied(slot),
+    // upsert(key) -> slot index (new keys start with count 0) and find_slot(key) -> slot index or NO_SLOT
+    template <typename Derived>
+    struct GroupedTable{
+        std::vector<HashEntry> entries; // grouped by key
+        size_t num_elements = 0;
+
+        // Serial build, threads is accepted for the JoinTable interface only
+        template <typename EntryAt>
+        void build_parallel(size_t count, [[maybe_unused]] size_t threads, EntryAt&& entry_at){
+            auto& self = static_cast<Derived&>(*this);
+            HashEntry entry;
+            num_elements = 0;
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                self.slots[self.upsert(entry.key)].count++;
+                ++num_elements;
+            }
+
+            uint32_t offset = 0;
+            for(auto& slot : self.slots){
+                if(!Derived::occupied(slot)) continue;
+                slot.begin = offset;
+                offset += slot.count;
+                slot.count = 0;
+            }
+
+            entries.resize(num_elements);
+            for(size_t i = 0; i < count; ++i){
+                if(!entry_at(i, entry)) continue;
+                auto& slot = self.slots[self.find_slot(entry.key)];
+                entries[slot.begin + slot.count++] = entry;
+            }
+        }
+
+        // All build entries of key (len = 0 and nullptr when it is absent)
+        const HashEntry* find_range(int32_t key, size_t& len) const{
+            const size_t idx = static_cast<const Derived&>(*this).find_slot(key);
+            if(idx == NO_SLOT){
+                len = 0;
+                return nullptr;
+            }
+            const auto& slot = static_cast<const Derived&>(*this).slots[idx];
+            len = slot.count;
+            return entries.data() + slot.begin;
+        }
+
+        size_t size() const{
+            return num_elements;
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,116 @@
+#pragma once
+// Hopscotch join table: a key is always within H slots of its home slot, and the home slot
+// keeps a bitmap of which of those H slots hold its keys, so a lookup reads one neighborhood.
+// An insert takes the nearest free slot and hops it back towards home by moving keys that
+// may move; when that fails the table doubles.
+// Columnar port of hopscotch/hopscotch.h, entries grouped by key (see grouped_table.h).
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct HopscotchTable : GroupedTable<HopscotchTable>{
+        static constexpr size_t H = 32; // neighborhood size, one bit per slot in the home bitmap
+
+        struct Slot : KeySlot{
+            uint32_t neighbors = 0; // bit d: slot home + d holds a key of this home
+            bool occupied = false;
+        };
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+
+        static bool occupied(const Slot& slot){
+            return slot.occupied;
+        }
+
+        void reserve(size_t build_size){
+            const size_t capacity = std::max<size_t>(2 * H, next_pow2(build_size) * 2);
+            slots.assign(capacity, Slot{});
+            mask = capacity - 1;
+        }
+
+        size_t home(int32_t key) const{
+            return mix32(key) & mask;
+        }
+
+        size_t find_slot(int32_t key) const{
+            const size_t i = home(key);
+            for(uint32_t bits = slots[i].neighbors; bits; bits &= bits - 1){
+                const size_t pos = (i + __builtin_ctz(bits)) & mask;
+                if(slots[pos].key == key) return pos;
+            }
+            return NO_SLOT;
+        }
+
+        size_t upsert(int32_t key){
+            if(const size_t found = find_slot(key); found != NO_SLOT) return found;
+
+            Slot slot;
+            slot.key = key;
+            slot.occupied = true;
+            while(!place(slot)) grow();
+            return find_slot(key);
+        }
+
+    private:
+        // Places key, count and begin of slot in its neighborhood; false when it has no room
+        bool place(const Slot& slot){
+            const size_t i = home(slot.key);
+            if(slots[i].neighbors == ~uint32_t{0}) return false;
+
+            size_t j = i;
+            while(slots[j].occupied) j = (j + 1) & mask; // never full: at least twice the keys
+
+            // hop the free slot j back until it is within H of i
+            while(((j - i) & mask) >= H){
+                size_t moved = NO_SLOT;
+                for(size_t offset = H - 1; offset > 0; --offset){
+                    const size_t k = (j - offset) & mask;
+                    if(!slots[k].occupied) continue;
+                    const size_t k_home = home(slots[k].key);
+                    if(((j - k_home) & mask) < H && ((k - k_home) & mask) < H){
+                        moved = k;
+                        break;
+                    }
+                }
+                if(moved == NO_SLOT) return false;
+
+                const size_t k_home = home(slots[moved].key);
+                const uint32_t neighbors_j = slots[j].neighbors;
+                static_cast<KeySlot&>(slots[j]) = static_cast<const KeySlot&>(slots[moved]);
+                slots[j].occupied = true;
+                slots[j].neighbors = neighbors_j;
+                slots[moved].occupied = false;
+                slots[k_home].neighbors &= ~(uint32_t{1} << ((moved - k_home) & mask));
+                slots[k_home].neighbors |= uint32_t{1} << ((j - k_home) & mask);
+                j = moved;
+            }
+
+            static_cast<KeySlot&>(slots[j]) = static_cast<const KeySlot&>(slot);
+            slots[j].occupied = true;
+            slots[i].neighbors |= uint32_t{1} << ((j - i) & mask);
+            return true;
+        }
+
+        // Doubles the table and reinserts every key with its counts
+        void grow(){
+            std::vector<Slot> old = std::move(slots);
+            size_t capacity = old.size();
+            bool placed = false;
+            while(!placed){
+                capacity *= 2;
+                slots.assign(capacity, Slot{});
+                mask = capacity - 1;
+                placed = std::all_of(old.begin(), old.end(), [&](const Slot& slot) { return !slot.occupied || place(slot); });
+            }
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,69 @@
+#pragma once
+// Robin Hood join table: linear probing where an insert takes the slot of any key that sits
+// closer to its home slot (smaller probe sequence length, psl) and moves that key on.
+// A lookup stops as soon as its own psl exceeds the psl of the slot it looks at.
+// Columnar port of robinhood/robinhood.h, entries grouped by key (see grouped_table.h).
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <grouped_table.h>
+
+namespace jointable{
+
+    struct RobinHoodTable : GroupedTable<RobinHoodTable>{
+        struct Slot : KeySlot{
+            int32_t psl = -1; // -1 => empty
+        };
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+
+        static bool occupied(const Slot& slot){
+            return slot.psl >= 0;
+        }
+
+        // Twice the next power of two over the build rows, so chains stay short
+        void reserve(size_t build_size){
+            const size_t capacity = next_pow2(build_size) * 2;
+            slots.assign(capacity, Slot{});
+            mask = capacity - 1;
+        }
+
+        size_t find_slot(int32_t key) const{
+            size_t pos = mix32(key) & mask;
+            for(int32_t psl = 0;; ++psl){
+                const Slot& slot = slots[pos];
+                if(!occupied(slot) || psl > slot.psl) return NO_SLOT;
+                if(slot.key == key) return pos;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+        size_t upsert(int32_t key){
+            if(const size_t found = find_slot(key); found != NO_SLOT) return found;
+
+            Slot current;
+            current.key = key;
+            current.psl = 0;
+            size_t pos = mix32(key) & mask;
+            size_t placed = NO_SLOT;
+            while(true){
+                Slot& slot = slots[pos];
+                if(!occupied(slot)){
+                    slot = current;
+                    return placed == NO_SLOT ? pos : placed;
+                }
+                if(current.psl > slot.psl){
+                    std::swap(slot, current);
+                    if(placed == NO_SLOT) placed = pos; // the new key stays here, the rich one moves on
+                }
+                current.psl++;
+                pos = (pos + 1) & mask;
+            }
+        }
+    };
+
+} // namespace jointable
@@ -0,0 +1,153 @@
+// Regression timings of an optimization stage on generated join plans.
+//
+// build against any stage, e.g. work_stealing (from optimizations/workload_gen, with the
+// contest include directory on the path and the stage sources of its predecessors if needed):
+//   g++ -std=c++20 -O3 -march=native -pthread -I<contest>/include -I. -I../work_stealing ...
+//       workload_bench.cpp ../work_stealing/execute.cpp ../building_parallelization/threaded_table.cpp -o workload_bench
+//
+// usage: ./workload_bench [--tables=4] [--shape=left-deep|bushy] [--probe-rows=N] [--build-rows=N]
+//                         [--fanout=F] [--build-skew=T] [--probe-skew=T] [--selectivity=S]
+//                         [--null-ratio=R] [--varchar-width=N] [--long-strings=R]
+//                         [--runs=3] [--seed=N] [--table-dir=DIR]
+//
+// --table-dir writes the generated tables to DIR in the native format (<table id>.spct) and
+// runs on them mapped by the context (SPC_TABLE_DIR) instead of on the generated copies. It
+// needs a stage whose context maps them (index_files and later), the others reject it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <plan.h>
+#include <table.h>
+#include <workload_gen.h>
+#if __has_include(<context.h>) && __has_include(<table_file.h>)
+#include <context.h>
+#include <table_file.h>
+#define WORKLOAD_TABLE_DIR
+#endif
+
+namespace {
+
+#ifdef WORKLOAD_TABLE_DIR
+    template <typename Context>
+    constexpr bool maps_tables = requires(Context& context){ context.tables; };
+    constexpr bool TABLE_DIR = maps_tables<Contest::ExecuteContext>;
+
+    // Binds the tables the context mapped from table_dir into the plan inputs
+    template <typename Context>
+    bool bind_mapped(Context* context, const std::string& table_dir, std::vector<ColumnarTable>& inputs,
+                     std::optional<tablefile::InputBinding>& binding){
+        if constexpr(maps_tables<Context>){
+            auto& tables = context->tables;
+            binding.emplace(inputs);
+            for(size_t table_id = 0; table_id < inputs.size(); ++table_id){
+                auto it = tables.find(std::to_string(table_id));
+                if(it == tables.end()){
+                    fprintf(stderr, "table %zu was not mapped from %s\n", table_id, table_dir.c_str());
+                    return false;
+                }
+                binding->bind(table_id, *it->second);
+            }
+        }
+        return true;
+    }
+#else
+    constexpr bool TABLE_DIR = false;
+#endif
+
+    workloadgen::GeneratorConfig parse_config(int argc, char** argv, size_t& runs, std::string& table_dir){
+        workloadgen::GeneratorConfig config;
+        for(int i = 1; i < argc; ++i){
+            std::string arg = argv[i];
+            auto value = [&](const char* flag) -> const char* {
+                size_t len = strlen(flag);
+                return arg.compare(0, len, flag) == 0 ? arg.c_str() + len : nullptr;
+            };
+            if(const char* v = value("--tables=")) config.num_tables = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--shape=")){
+                if(strcmp(v, "left-deep") == 0) config.shape = workloadgen::PlanShape::LEFT_DEEP;
+                else if(strcmp(v, "bushy") == 0) config.shape = workloadgen::PlanShape::BUSHY;
+                else{
+                    fprintf(stderr, "unknown plan shape %s\n", v);
+                    exit(1);
+                }
+            }
+            else if(const char* v = value("--probe-rows=")) config.probe_rows = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--build-rows=")) config.build_rows = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--fanout=")) config.fanout = strtod(v, nullptr);
+            else if(const char* v = value("--build-skew=")) config.build_skew = strtod(v, nullptr);
+            else if(const char* v = value("--probe-skew=")) config.probe_skew = strtod(v, nullptr);
+            else if(const char* v = value("--selectivity=")) config.selectivity = strtod(v, nullptr);
+            else if(const char* v = value("--null-ratio=")) config.null_ratio = strtod(v, nullptr);
+            else if(const char* v = value("--varchar-width=")) config.varchar_width = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--long-strings=")) config.long_string_ratio = strtod(v, nullptr);
+            else if(const char* v = value("--seed=")) config.seed = strtoull(v, nullptr, 10);
+            else if(const char* v = value("--runs=")) runs = std::max<size_t>(1, strtoull(v, nullptr, 10));
+            else if(const char* v = value("--table-dir=")) table_dir = v;
+            else{
+                fprintf(stderr, "unknown option %s\n", arg.c_str());
+                exit(1);
+            }
+        }
+        return config;
+    }
+
+} // namespace
+
+int main(int argc, char** argv){
+    size_t runs = 3;
+    std::string table_dir;
+    workloadgen::GeneratorConfig config = parse_config(argc, argv, runs, table_dir);
+    if(!table_dir.empty() && !TABLE_DIR){
+        fprintf(stderr, "--table-dir needs a stage whose context maps SPC_TABLE_DIR (index_files or later)\n");
+        return 1;
+    }
+
+    auto gen_begin = std::chrono::steady_clock::now();
+    workloadgen::Workload workload = workloadgen::generate(config);
+    auto gen_end = std::chrono::steady_clock::now();
+    fprintf(stderr, "generated %zu tables, %zu joins in %.1f ms\n", workload.plan.inputs.size(), workload.edges.size(),
+        std::chrono::duration<double, std::milli>(gen_end - gen_begin).count());
+
+#ifdef WORKLOAD_TABLE_DIR
+    if(!table_dir.empty()){
+        for(size_t table_id = 0; table_id < workload.plan.inputs.size(); ++table_id){
+            tablefile::write_table(workload.plan.inputs[table_id], table_dir + "/" + std::to_string(table_id) + ".spct");
+        }
+        setenv("SPC_TABLE_DIR", table_dir.c_str(), 1);
+    }
+#endif
+
+    void* context = Contest::build_context();
+
+#ifdef WORKLOAD_TABLE_DIR
+    // the mapped tables replace the generated ones until the binding goes, before the context
+    std::optional<tablefile::InputBinding> binding;
+    if(!table_dir.empty() && !bind_mapped(static_cast<Contest::ExecuteContext*>(context), table_dir, workload.plan.inputs, binding)){
+        return 1;
+    }
+#endif
+
+    double best = 0;
+    for(size_t run = 0; run < runs; ++run){
+        auto begin = std::chrono::steady_clock::now();
+        ColumnarTable result = Contest::execute(workload.plan, context);
+        auto end = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        if(run == 0 || ms < best) best = ms;
+        printf("run %zu: %zu rows in %.2f ms\n", run, result.num_rows, ms);
+    }
+#ifdef WORKLOAD_TABLE_DIR
+    binding.reset();
+#endif
+    Contest::destroy_context(context);
+    printf("best: %.2f ms\n", best);
+    return 0;
+}
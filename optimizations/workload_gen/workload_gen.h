@@ -0,0 +1,339 @@
+#pragma once
+// Synthetic join plans for offline regression timings.
+// Generates a Plan and its ColumnarTable inputs in the contest page format
+// (NULL bitmaps, long string pages included) with control over the plan shape,
+// join fanout, key skew, selectivity, null ratio and VARCHAR width.
+//
+// Every table t has the columns
+//   [key, fk 0 .. fk k-1, payload INT32, payload VARCHAR]
+// The plan is a binary tree over the tables [0, n): a subtree [lo, hi) is split
+// into [lo, mid) and [mid, hi), joined on (next fk of table lo) = (key of table mid).
+// Left-deep plans use mid = hi - 1, bushy plans mid = (lo + hi) / 2.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <plan.h>
+#include <table.h>
+
+namespace workloadgen{
+
+    enum class PlanShape{ LEFT_DEEP, BUSHY };
+
+    struct GeneratorConfig{
+        size_t num_tables = 4;
+        PlanShape shape = PlanShape::LEFT_DEEP;
+        size_t probe_rows = 1000000;      // rows of table 0
+        size_t build_rows = 100000;       // rows of every other table
+        double fanout = 1.0;              // build rows per distinct key
+        double build_skew = 0.0;          // zipf theta of the build key duplicates (0 => uniform)
+        double probe_skew = 0.0;          // zipf theta of the fk values (0 => uniform)
+        double selectivity = 1.0;         // share of non NULL fk values that find a match
+        double null_ratio = 0.0;          // share of NULLs in every column
+        size_t varchar_width = 16;        // average VARCHAR length
+        double long_string_ratio = 0.0;   // share of VARCHARs longer than a page
+        uint64_t seed = 42;
+    };
+
+    // ---------------------------------------------------------------- page writers
+
+    struct IntColumnWriter{
+        Column column{DataType::INT32};
+        std::vector<int32_t> data;
+        std::vector<uint8_t> bitmap;
+        uint16_t num_rows = 0;
+
+        void append(std::optional<int32_t> value){
+            // header + data + bitmap must fit in the page
+            size_t num_values = data.size() + (value ? 1 : 0);
+            if(4 + num_values * sizeof(int32_t) + (num_rows + 1 + 7) / 8 > PAGE_SIZE) flush();
+
+            if(num_rows % 8 == 0) bitmap.push_back(0);
+            if(value){
+                bitmap[num_rows / 8] |= static_cast<uint8_t>(1u << (num_rows % 8));
+                data.push_back(*value);
+            }
+            ++num_rows;
+        }
+
+        void flush(){
+            if(num_rows == 0) return;
+            std::byte* page = column.new_page()->data;
+            *reinterpret_cast<uint16_t*>(page) = num_rows;
+            *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(data.size());
+            memcpy(page + 4, data.data(), data.size() * sizeof(int32_t));
+            memcpy(page + PAGE_SIZE - bitmap.size(), bitmap.data(), bitmap.size());
+            data.clear();
+            bitmap.clear();
+            num_rows = 0;
+        }
+
+        Column finish(){
+            flush();
+            return std::move(column);
+        }
+    };
+
+    struct VarcharColumnWriter{
+        Column column{DataType::VARCHAR};
+        std::vector<uint16_t> offsets; // end offset of every string
+        std::string chars;
+        std::vector<uint8_t> bitmap;
+        uint16_t num_rows = 0;
+
+        void append(const std::optional<std::string>& value){
+            if(value && value->size() > PAGE_SIZE - 7){
+                flush();
+                append_long(*value);
+                return;
+            }
+
+            size_t num_offsets = offsets.size() + (value ? 1 : 0);
+            size_t num_chars = chars.size() + (value ? value->size() : 0);
+            if(4 + num_offsets * sizeof(uint16_t) + num_chars + (num_rows + 1 + 7) / 8 > PAGE_SIZE) flush();
+
+            if(num_rows % 8 == 0) bitmap.push_back(0);
+            if(value){
+                bitmap[num_rows / 8] |= static_cast<uint8_t>(1u << (num_rows % 8));
+                chars += *value;
+                offsets.push_back(static_cast<uint16_t>(chars.size()));
+            }
+            ++num_rows;
+        }
+
+        // one 0xffff page followed by 0xfffe continuation pages
+        void append_long(const std::string& value){
+            size_t offset = 0;
+            bool first = true;
+            while(offset < value.size()){
+                std::byte* page = column.new_page()->data;
+                size_t len = std::min(value.size() - offset, PAGE_SIZE - 4);
+                *reinterpret_cast<uint16_t*>(page) = first ? 0xffff : 0xfffe;
+                *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(len);
+                memcpy(page + 4, value.data() + offset, len);
+                offset += len;
+                first = false;
+            }
+        }
+
+        void flush(){
+            if(num_rows == 0) return;
+            std::byte* page = column.new_page()->data;
+            *reinterpret_cast<uint16_t*>(page) = num_rows;
+            *reinterpret_cast<uint16_t*>(page + 2) = static_cast<uint16_t>(offsets.size());
+            memcpy(page + 4, offsets.data(), offsets.size() * sizeof(uint16_t));
+            memcpy(page + 4 + offsets.size() * sizeof(uint16_t), chars.data(), chars.size());
+            memcpy(page + PAGE_SIZE - bitmap.size(), bitmap.data(), bitmap.size());
+            offsets.clear();
+            chars.clear();
+            bitmap.clear();
+            num_rows = 0;
+        }
+
+        Column finish(){
+            flush();
+            return std::move(column);
+        }
+    };
+
+    // ---------------------------------------------------------------- value generators
+
+    // Zipf distributed ranks in [0, n) through the inverse of the cumulative distribution
+    struct ZipfSampler{
+        std::vector<double> cdf;
+
+        ZipfSampler(size_t n, double theta) : cdf(std::max<size_t>(n, 1)){
+            double sum = 0;
+            for(size_t i = 0; i < cdf.size(); ++i){
+                sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+                cdf[i] = sum;
+            }
+            for(auto& c : cdf) c /= sum;
+        }
+
+        template <typename Rng>
+        size_t operator()(Rng& rng){
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            size_t rank = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            return std::min(rank, cdf.size() - 1);
+        }
+    };
+
+    // Key values of a table: a bijection of the rank so heavy ranks are spread over the domain.
+    // Ranks >= num_distinct are never used as keys, fk values drawn from there never match.
+    inline int32_t key_of(size_t table_id, uint64_t rank){
+        return static_cast<int32_t>((static_cast<uint32_t>(rank) * 0x9E3779B1u) ^ (static_cast<uint32_t>(table_id) * 0x85ebca6bu));
+    }
+
+    inline size_t num_distinct_keys(const GeneratorConfig& config){
+        return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(config.build_rows) / std::max(config.fanout, 1e-9)));
+    }
+
+    // ---------------------------------------------------------------- plan
+
+    struct JoinEdge{
+        size_t probe_table;
+        size_t probe_fk;      // fk index inside the probe table
+        size_t build_table;
+    };
+
+    struct Workload{
+        Plan plan;
+        std::vector<JoinEdge> edges;
+    };
+
+    // column layout of a table with `num_fks` fk columns
+    inline size_t fk_column(size_t fk){ return 1 + fk; }
+    inline size_t payload_int_column(size_t num_fks){ return 1 + num_fks; }
+    inline size_t payload_varchar_column(size_t num_fks){ return 2 + num_fks; }
+
+    // Output columns of a subtree: (table, column) in output order
+    using Columns = std::vector<std::pair<size_t, size_t>>;
+
+    struct PlanBuilder{
+        const GeneratorConfig& config;
+        std::vector<size_t>& num_fks;
+        std::vector<JoinEdge>& edges;
+        Plan& plan;
+
+        // Columns a subtree must keep: fks of its tables still waiting for their join + payloads
+        Columns needed_columns(const Columns& available, const std::vector<JoinEdge>& pending) const{
+            Columns needed;
+            for(const auto& [table, column] : available){
+                bool keep = column == payload_int_column(num_fks[table]) || column == payload_varchar_column(num_fks[table]);
+                for(const auto& edge : pending){
+                    keep |= edge.probe_table == table && column == fk_column(edge.probe_fk);
+                    keep |= edge.build_table == table && column == 0;
+                }
+                if(keep) needed.emplace_back(table, column);
+            }
+            return needed;
+        }
+
+        static DataType column_type(size_t column, size_t table_fks){
+            return column == payload_varchar_column(table_fks) ? DataType::VARCHAR : DataType::INT32;
+        }
+
+        // returns the node index, fills the columns it outputs
+        size_t build(size_t lo, size_t hi, const std::vector<JoinEdge>& pending, Columns& out){
+            if(hi - lo == 1){
+                Columns all;
+                for(size_t column = 0; column < payload_varchar_column(num_fks[lo]) + 1; ++column) all.emplace_back(lo, column);
+                out = needed_columns(all, pending);
+
+                std::vector<std::tuple<size_t, DataType>> attrs;
+                for(const auto& [table, column] : out) attrs.emplace_back(column, column_type(column, num_fks[table]));
+                plan.nodes.push_back(PlanNode{ScanNode{lo}, std::move(attrs)});
+                return plan.nodes.size() - 1;
+            }
+
+            size_t mid = config.shape == PlanShape::LEFT_DEEP ? hi - 1 : (lo + hi) / 2;
+            JoinEdge edge{lo, num_fks[lo]++, mid};
+            edges.push_back(edge);
+
+            std::vector<JoinEdge> child_pending = pending;
+            child_pending.push_back(edge);
+
+            Columns left_columns, right_columns;
+            size_t left = build(lo, mid, child_pending, left_columns);
+            size_t right = build(mid, hi, child_pending, right_columns);
+
+            Columns all = left_columns;
+            all.insert(all.end(), right_columns.begin(), right_columns.end());
+            out = needed_columns(all, pending);
+
+            auto position = [&](size_t table, size_t column){
+                return static_cast<size_t>(std::find(all.begin(), all.end(), std::make_pair(table, column)) - all.begin());
+            };
+            std::vector<std::tuple<size_t, DataType>> attrs;
+            for(const auto& [table, column] : out) attrs.emplace_back(position(table, column), column_type(column, num_fks[table]));
+
+            const size_t left_attr = position(edge.probe_table, fk_column(edge.probe_fk));
+            const size_t right_attr = position(edge.build_table, 0) - left_columns.size();
+            plan.nodes.push_back(PlanNode{JoinNode{false, left, right, left_attr, right_attr}, std::move(attrs)});
+            return plan.nodes.size() - 1;
+        }
+    };
+
+    inline std::string make_string(std::mt19937_64& rng, const GeneratorConfig& config){
+        size_t len;
+        if(config.long_string_ratio > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.long_string_ratio){
+            len = PAGE_SIZE + rng() % (3 * PAGE_SIZE);
+        }
+        else{
+            len = config.varchar_width == 0 ? 0 : rng() % (2 * config.varchar_width + 1);
+        }
+        std::string value(len, 'a');
+        for(auto& c : value) c = static_cast<char>('a' + rng() % 26);
+        return value;
+    }
+
+    inline Workload generate(const GeneratorConfig& config){
+        if(config.num_tables < 2) throw std::runtime_error("workloadgen: at least two tables are needed for a join");
+
+        Workload workload;
+        std::vector<size_t> num_fks(config.num_tables, 0);
+        PlanBuilder builder{config, num_fks, workload.edges, workload.plan};
+        Columns root_columns;
+        workload.plan.root = builder.build(0, config.num_tables, {}, root_columns);
+
+        std::mt19937_64 rng(config.seed);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        const size_t num_distinct = num_distinct_keys(config);
+        ZipfSampler build_sampler(num_distinct, config.build_skew);
+        ZipfSampler probe_sampler(num_distinct, config.probe_skew);
+
+        for(size_t table_id = 0; table_id < config.num_tables; ++table_id){
+            const size_t num_rows = table_id == 0 ? config.probe_rows : config.build_rows;
+            auto is_null = [&]{ return config.null_ratio > 0 && coin(rng) < config.null_ratio; };
+
+            // fk column -> table it references
+            std::vector<size_t> fk_targets(num_fks[table_id]);
+            for(const auto& edge : workload.edges){
+                if(edge.probe_table == table_id) fk_targets[edge.probe_fk] = edge.build_table;
+            }
+
+            IntColumnWriter key_writer;
+            std::vector<IntColumnWriter> fk_writers(num_fks[table_id]);
+            IntColumnWriter int_writer;
+            VarcharColumnWriter varchar_writer;
+
+            for(size_t row_idx = 0; row_idx < num_rows; ++row_idx){
+                // every distinct key once before the skewed duplicates, so the domain is covered
+                size_t rank = (row_idx < num_distinct || config.build_skew == 0) ? row_idx % num_distinct : build_sampler(rng);
+                key_writer.append(is_null() ? std::nullopt : std::optional<int32_t>(key_of(table_id, rank)));
+
+                for(size_t fk = 0; fk < fk_targets.size(); ++fk){
+                    std::optional<int32_t> value;
+                    if(!is_null()){
+                        value = coin(rng) < config.selectivity ? key_of(fk_targets[fk], probe_sampler(rng))
+                                                               : key_of(fk_targets[fk], num_distinct + rng() % num_distinct);
+                    }
+                    fk_writers[fk].append(value);
+                }
+
+                int_writer.append(is_null() ? std::nullopt : std::optional<int32_t>(static_cast<int32_t>(rng())));
+                varchar_writer.append(is_null() ? std::nullopt : std::optional<std::string>(make_string(rng, config)));
+            }
+
+            ColumnarTable table;
+            table.num_rows = num_rows;
+            table.columns.push_back(key_writer.finish());
+            for(auto& writer : fk_writers) table.columns.push_back(writer.finish());
+            table.columns.push_back(int_writer.finish());
+            table.columns.push_back(varchar_writer.finish());
+            workload.plan.inputs.push_back(std::move(table));
+        }
+        return workload;
+    }
+
+} // namespace workloadgen